@@ -0,0 +1,189 @@
+#include "analyse.hpp"
+
+#include "board.hpp"
+#include "misc.hpp"
+#include "move.hpp"
+#include "packed.hpp"
+#include "tt.hpp"
+#include "uci.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace Analyse
+{
+
+// Seconds between progress reports
+const int REPORT_INTERVAL = 10;
+
+// Moves to mate (negative when getting mated), or 0 for a normal score
+int mateIn(const int score)
+{
+    if (score > Search::MATE_SCORE && score < Search::MATE_VALUE)
+        return (Search::MATE_VALUE - score) / 2 + 1;
+    if (score < -Search::MATE_SCORE && score > -Search::MATE_VALUE)
+        return -(score + Search::MATE_VALUE) / 2 - 1;
+    return 0;
+}
+
+std::string csvField(const std::string& value)
+{
+    if (value.find_first_of(",\"") == std::string::npos)
+        return value;
+    std::string quoted = "\"";
+    for (char c : value)
+        quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+    return quoted + "\"";
+}
+
+std::string jsonString(const std::string& value)
+{
+    std::string quoted = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\')
+            quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+std::string header(const Format format)
+{
+    return format == Format::CSV ? "fen,id,bestmove,score,mate,depth,nodes,time_ms,pv\n" : "";
+}
+
+// One line of output for an analysed position
+std::string formatResult(const Format format, const std::string& fen, const std::string& id,
+                         const Search::SearchResult& result, const uint64_t nodes,
+                         const int64_t time)
+{
+    std::string pv;
+    for (int move : result.pv)
+        pv += (pv.empty() ? "" : " ") + Move::toString(move);
+    int mate = mateIn(result.score);
+    std::ostringstream out;
+    if (format == Format::CSV) {
+        out << fen << "," << csvField(id) << "," << Move::toString(result.bestMove) << ","
+            << (mate ? "" : std::to_string(result.score)) << ","
+            << (mate ? std::to_string(mate) : "") << "," << result.depth << "," << nodes << ","
+            << time << "," << pv << "\n";
+    } else {
+        out << "{\"fen\": " << jsonString(fen) << ", \"id\": " << jsonString(id)
+            << ", \"bestmove\": \"" << Move::toString(result.bestMove) << "\", \"score\": "
+            << (mate ? "null" : std::to_string(result.score))
+            << ", \"mate\": " << (mate ? std::to_string(mate) : "null")
+            << ", \"depth\": " << result.depth << ", \"nodes\": " << nodes
+            << ", \"time_ms\": " << time << ", \"pv\": \"" << pv << "\"}\n";
+    }
+    return out.str();
+}
+
+void run(const Params& params)
+{
+    Packed::Reader reader;
+    std::vector<std::string> lines;
+    size_t count;
+    bool packed = params.inputFile.size() > 4 &&
+                  params.inputFile.compare(params.inputFile.size() - 4, 4, ".bin") == 0;
+    if (packed) {
+        if (!reader.open(params.inputFile)) {
+            std::cout << "Could not open " << params.inputFile << "\n";
+            return;
+        }
+        count = reader.count;
+    } else {
+        std::ifstream file(params.inputFile);
+        if (!file) {
+            std::cout << "Could not open " << params.inputFile << "\n";
+            return;
+        }
+        std::string line;
+        while (std::getline(file, line))
+            if (!line.empty())
+                lines.push_back(line);
+        count = lines.size();
+    }
+    std::ofstream out(params.outputFile);
+    if (!out) {
+        std::cout << "Could not open " << params.outputFile << "\n";
+        return;
+    }
+    out << header(params.format);
+
+    // Results are handed to this thread, which writes them out in order as soon as all the
+    // positions before them are done
+    std::vector<std::string> results(count);
+    std::vector<char> done(count, 0);
+    std::mutex resultsMutex;
+    std::condition_variable resultReady;
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        TT::Table table((size_t)std::max(params.hashMB, 1) * TT::PER_MB);
+        TT::useTable(&table);
+        UCI::nodeLimit = params.nodes;
+        Board board;
+        size_t i;
+        while ((i = next++) < count) {
+            std::string id, result;
+            bool valid = true;
+            if (packed) {
+                Packed::unpack(reader[i], board);
+            } else {
+                int score;
+                Packed::Result gameResult;
+                valid = Packed::parseLine(lines[i], board, score, gameResult);
+                id = Packed::operation(lines[i], "id");
+            }
+            if (valid) {
+                int64_t startTime = Time::now();
+                UCI::isTimeControlled = params.moveTime > 0;
+                UCI::stopTime = startTime + params.moveTime;
+                Search::clearKeyHistory();
+                Search::SearchResult searchResult = Search::position(board, params.depth, false);
+                result = formatResult(params.format, board.getFen(), id, searchResult,
+                                      Search::nodes, Time::now() - startTime);
+            }
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            results[i] = std::move(result);
+            done[i] = 1;
+            resultReady.notify_one();
+        }
+        TT::useTable(nullptr);
+    };
+
+    int threads = std::max(params.threads, 1);
+    std::cout << "Analysing " << count << " positions on " << threads << " threads\n";
+    int64_t startTime = Time::now(), lastReport = startTime;
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++)
+        pool.emplace_back(worker);
+    for (size_t i = 0; i < count; i++) {
+        std::unique_lock<std::mutex> lock(resultsMutex);
+        while (!resultReady.wait_for(lock, std::chrono::seconds(1), [&]() { return done[i]; })) {
+            if (Time::now() - lastReport >= REPORT_INTERVAL * 1000) {
+                lastReport = Time::now();
+                std::cout << "analysed " << i << "/" << count << " positions, "
+                          << i * 1000 / std::max<int64_t>(lastReport - startTime, 1)
+                          << " pos/s\n";
+            }
+        }
+        std::string result = std::move(results[i]);
+        lock.unlock();
+        out << result;
+    }
+    for (std::thread& thread : pool)
+        thread.join();
+
+    int64_t elapsed = std::max<int64_t>(Time::now() - startTime, 1);
+    std::cout << "Analysed " << count << " positions in " << elapsed << " ms, "
+              << (double)count * 1000 / elapsed << " pos/s\n";
+}
+
+} // namespace Analyse
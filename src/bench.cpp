@@ -0,0 +1,161 @@
+#include "bench.hpp"
+
+#include "eval.hpp"
+#include "misc.hpp"
+#include "move.hpp"
+#include "nnue.hpp"
+#include "search.hpp"
+#include "tt.hpp"
+#include "tt_eval.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace Bench {
+
+// Mix of opening, middlegame and endgame positions
+const std::vector<std::string> positions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bq1rk1/pp2bppp/2n2n2/3p4/3P4/2NBPN2/PP3PPP/R2QK2R w KQ - 3 10",
+    "2r2rk1/1bqnbppp/pp1ppn2/8/2PNP3/1PN1B3/P3BPPP/2RQ1RK1 w - - 2 14",
+    "r1b2rk1/2q1bppp/p2ppn2/1p6/3BPP2/2NB4/PPPQ2PP/2KR3R w - - 0 13",
+    "6k1/5p2/6p1/8/7p/8/6PP/6K1 b - - 0 1",
+    "8/8/3k4/3p4/3P4/3K4/8/8 b - - 0 1",
+    "5rk1/pp3ppp/8/3R4/8/8/PP3PPP/6K1 w - - 0 1",
+};
+
+// Search every position to a fixed depth and report the total node count and speed
+void search(const int depth) {
+    uint64_t totalNodes = 0;
+    int64_t startTime = Time::now();
+    for (const std::string& fen : positions) {
+        Board board(fen);
+        TT::clearTTtable();
+        Search::clearKeyHistory();
+        Search::position(board, depth);
+        totalNodes += Search::nodes;
+    }
+    int64_t elapsed = std::max<int64_t>(Time::now() - startTime, 1);
+    std::cout << "\n     Nodes: " << totalNodes << "\n";
+    std::cout << "      Time: " << elapsed << "\n";
+    std::cout << "       NPS: " << totalNodes * 1000 / elapsed << "\n";
+}
+
+// Every position up to two plies away from the bench positions
+std::vector<Board> collectBoards() {
+    std::vector<Board> boards;
+    for (const std::string& fen : positions) {
+        Board root(fen);
+        boards.push_back(root);
+        Move::MoveList rootMoves;
+        Move::generate(rootMoves, root);
+        for (int i = 0; i < rootMoves.count; i++) {
+            Board child = root;
+            if (!Move::make(&child, rootMoves.list[i], Move::MoveType::allMoves))
+                continue;
+            boards.push_back(child);
+            Move::MoveList childMoves;
+            Move::generate(childMoves, child);
+            for (int j = 0; j < childMoves.count; j++) {
+                Board grandChild = child;
+                if (Move::make(&grandChild, childMoves.list[j], Move::MoveType::allMoves))
+                    boards.push_back(grandChild);
+            }
+        }
+    }
+    return boards;
+}
+
+// Evaluate every position up to two plies away from the bench positions 'passes' times
+void eval(const int passes) {
+    std::vector<Board> boards = collectBoards();
+
+    // Keeps the evaluations from being optimized away
+    int64_t checksum = 0;
+    // A single pass can take less than a millisecond, so passes are timed in microseconds
+    std::chrono::microseconds passTime{0};
+    for (int pass = 0; pass < passes; pass++) {
+        // Every pass would be answered from the evaluation cache otherwise; clearing it is
+        // left out of the timing
+        TT::Eval::clearEvalTable();
+        auto startTime = std::chrono::steady_clock::now();
+        for (const Board& board : boards)
+            checksum += Eval::EvalPosition(board);
+        passTime += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime);
+    }
+    int64_t elapsed = std::max<int64_t>(passTime.count() / 1000, 1);
+    uint64_t evals = (uint64_t)passes * boards.size();
+
+    std::cout << "\n Positions: " << boards.size() << "\n";
+    std::cout << "     Evals: " << evals << "\n";
+    std::cout << "      Time: " << elapsed << "\n";
+    std::cout << " Evals/sec: " << evals * 1000 / elapsed << "\n";
+    std::cout << "  Checksum: " << checksum << "\n";
+}
+
+// Evaluates the children of 'board' down to 'depth' plies, updating the accumulators on the way
+int64_t nnueTree(Board& board, const int depth) {
+    int64_t checksum = 0;
+    Move::MoveList moveList;
+    Move::generate(moveList, board);
+    for (int i = 0; i < moveList.count; i++) {
+        Board clone = board;
+        if (!Move::make(&board, moveList.list[i], Move::MoveType::allMoves))
+            continue;
+        Search::ply++;
+        NNUE::push(board);
+        checksum += NNUE::evaluate(board);
+        if (depth > 1)
+            checksum += nnueTree(board, depth - 1);
+        Search::ply--;
+        board = clone;
+    }
+    return checksum;
+}
+
+// Time NNUE inference over the same positions as 'eval', once refreshing both accumulators for
+// every position and once updating them incrementally along the move tree
+void nnue(const int passes) {
+    if (!NNUE::isLoaded) {
+        std::cout << "No network loaded, using random weights\n";
+        NNUE::randomize();
+    }
+    std::vector<Board> boards = collectBoards();
+    uint64_t evals = (uint64_t)passes * boards.size();
+
+    NNUE::Accumulator acc;
+    int64_t refreshChecksum = 0;
+    int64_t startTime = Time::now();
+    for (int pass = 0; pass < passes; pass++)
+        for (const Board& board : boards) {
+            NNUE::refresh(board, acc);
+            refreshChecksum += NNUE::output(acc, board.state.side);
+        }
+    int64_t refreshTime = std::max<int64_t>(Time::now() - startTime, 1);
+
+    int64_t incrementalChecksum = 0;
+    startTime = Time::now();
+    for (int pass = 0; pass < passes; pass++)
+        for (const std::string& fen : positions) {
+            Board root(fen);
+            Search::ply = 0;
+            NNUE::reset(root);
+            incrementalChecksum += NNUE::evaluate(root);
+            incrementalChecksum += nnueTree(root, 2);
+        }
+    int64_t incrementalTime = std::max<int64_t>(Time::now() - startTime, 1);
+
+    std::cout << "\n            Positions: " << boards.size() << "\n";
+    std::cout << "                Evals: " << evals << "\n";
+    std::cout << "    Refresh evals/sec: " << evals * 1000 / refreshTime << "\n";
+    std::cout << "Incremental evals/sec: " << evals * 1000 / incrementalTime << "\n";
+    std::cout << "             Checksum: " << refreshChecksum << " "
+              << (refreshChecksum == incrementalChecksum ? "(match)" : "(MISMATCH)") << "\n";
+}
+} // namespace Bench
@@ -51,14 +51,18 @@ void Position::updateUnits()
 
 void EvalState::addPieceScores(const Piece piece, const Sq target)
 {
-    Color pieceClr = (int)piece < 6 ? Color::WHITE : Color::BLACK;
-    Sq pieceTarget = pieceClr == Color::WHITE ? target : (Sq)FLIP(target);
-
-    mgScores[(int)pieceClr] += Eval::PIECE_VALUES[(int)Eval::Phase::MG][COLORLESS(piece)] +
-                               Eval::PSQT_MG[COLORLESS(piece)][(int)pieceTarget];
-    egScores[(int)pieceClr] += Eval::PIECE_VALUES[(int)Eval::Phase::EG][COLORLESS(piece)] +
-                               Eval::PSQT_EG[COLORLESS(piece)][(int)pieceTarget];
-    phase -= Eval::PHASE_VALUES[COLORLESS(piece)];
+    scores[(int)piece < 6 ? (int)Color::WHITE : (int)Color::BLACK] +=
+        Eval::psq[(int)piece][(int)target];
+    if (dirty.addedCount < dirty.added.size())
+        dirty.added[dirty.addedCount++] = (uint16_t)((int)piece * 64 + (int)target);
+}
+
+void EvalState::removePieceScores(const Piece piece, const Sq target)
+{
+    scores[(int)piece < 6 ? (int)Color::WHITE : (int)Color::BLACK] -=
+        Eval::psq[(int)piece][(int)target];
+    if (dirty.removedCount < dirty.removed.size())
+        dirty.removed[dirty.removedCount++] = (uint16_t)((int)piece * 64 + (int)target);
 }
 
 Board::Board() { parseFen(position[1], *this); }
@@ -79,6 +83,7 @@ void Board::display() const
     printCastling();
     std::cout << "         Enpassant: "
               << (state.enpassant != Sq::noSq ? strCoords[(int)state.enpassant] : "noSq") << "\n";
+    std::cout << "        Half moves: " << state.halfMoves << "\n";
     std::cout << "        Full moves: " << state.fullMoves << "\n";
 }
 
@@ -98,6 +103,44 @@ void Board::printCastling() const
     std::cout << "        Full moves: " << castlingLtrs << "\n";
 }
 
+std::string Board::getFen() const
+{
+    std::string fen;
+    for (int r = 0; r < 8; r++) {
+        int empty = 0;
+        for (int f = 0; f < 8; f++) {
+            int piece = pos.getPieceOnSquare(SQ(r, f));
+            if (piece == (int)Piece::E) {
+                empty++;
+                continue;
+            }
+            if (empty)
+                fen += (char)('0' + empty);
+            empty = 0;
+            fen += pieceStr[piece];
+        }
+        if (empty)
+            fen += (char)('0' + empty);
+        if (r < 7)
+            fen += '/';
+    }
+    fen += state.side == Color::WHITE ? " w " : " b ";
+
+    std::string castlingLtrs;
+    if (state.castling & (1 << (int)CastlingRights::wk))
+        castlingLtrs += 'K';
+    if (state.castling & (1 << (int)CastlingRights::wq))
+        castlingLtrs += 'Q';
+    if (state.castling & (1 << (int)CastlingRights::bk))
+        castlingLtrs += 'k';
+    if (state.castling & (1 << (int)CastlingRights::bq))
+        castlingLtrs += 'q';
+    fen += castlingLtrs.empty() ? "-" : castlingLtrs;
+    fen += " " + (state.enpassant != Sq::noSq ? strCoords[(int)state.enpassant] : "-");
+    fen += " " + std::to_string(state.halfMoves) + " " + std::to_string(state.fullMoves);
+    return fen;
+}
+
 int Position::getPieceOnSquare(const int sq) const
 {
     using enum Piece;
@@ -108,50 +151,78 @@ int Position::getPieceOnSquare(const int sq) const
     return (int)E;
 }
 
-bool Board::isSquareAttacked(const int sq) const
+bool Board::isSquareAttacked(const int sq) const { return isSquareAttacked(sq, state.side); }
+
+bool Board::isSquareAttacked(const int sq, const Color side) const
 {
     // Attacked by white pawns
-    if ((state.side == Color::WHITE) &&
+    if ((side == Color::WHITE) &&
         (Attack::pawnAttacks[(int)Color::BLACK][sq] & pos.pieces[(int)Piece::P]))
         return true;
     // Attacked by black pawns
-    if ((state.side == Color::BLACK) &&
+    if ((side == Color::BLACK) &&
         (Attack::pawnAttacks[(int)Color::WHITE][sq] & pos.pieces[(int)Piece::p]))
         return true;
     // Attacked by knights
     if (Attack::knightAttacks[sq] &
-        pos.pieces[state.side == Color::WHITE ? (int)Piece::N : (int)Piece::n])
+        pos.pieces[side == Color::WHITE ? (int)Piece::N : (int)Piece::n])
         return true;
     // Attacked by bishops
     if (Magics::getBishopAttack(sq, pos.units[(int)Color::BOTH]) &
-        pos.pieces[state.side == Color::WHITE ? (int)Piece::B : (int)Piece::b])
+        pos.pieces[side == Color::WHITE ? (int)Piece::B : (int)Piece::b])
         return true;
     // Attacked by rooks
     if (Magics::getRookAttack(sq, pos.units[(int)Color::BOTH]) &
-        pos.pieces[state.side == Color::WHITE ? (int)Piece::R : (int)Piece::r])
+        pos.pieces[side == Color::WHITE ? (int)Piece::R : (int)Piece::r])
         return true;
     // Attacked by queens
     if (Magics::getQueenAttack(sq, pos.units[(int)Color::BOTH]) &
-        pos.pieces[state.side == Color::WHITE ? (int)Piece::Q : (int)Piece::q])
+        pos.pieces[side == Color::WHITE ? (int)Piece::Q : (int)Piece::q])
         return true;
     // Attacked by kings
     if (Attack::kingAttacks[sq] &
-        pos.pieces[state.side == Color::WHITE ? (int)Piece::K : (int)Piece::k])
+        pos.pieces[side == Color::WHITE ? (int)Piece::K : (int)Piece::k])
         return true;
 
     // If all of the above cases fail, return false
     return false;
 }
 
+// Pieces of both colors attacking a square, given the occupancy
+uint64_t Board::attackersTo(const int sq, const uint64_t occupancy) const
+{
+    using enum Piece;
+    uint64_t bishopsQueens = pos.pieces[(int)B] | pos.pieces[(int)b] | pos.pieces[(int)Q] |
+                             pos.pieces[(int)q];
+    uint64_t rooksQueens = pos.pieces[(int)R] | pos.pieces[(int)r] | pos.pieces[(int)Q] |
+                           pos.pieces[(int)q];
+
+    return (Attack::pawnAttacks[(int)Color::BLACK][sq] & pos.pieces[(int)P]) |
+           (Attack::pawnAttacks[(int)Color::WHITE][sq] & pos.pieces[(int)p]) |
+           (Attack::knightAttacks[sq] & (pos.pieces[(int)N] | pos.pieces[(int)n])) |
+           (Attack::kingAttacks[sq] & (pos.pieces[(int)K] | pos.pieces[(int)k])) |
+           (Magics::getBishopAttack(sq, occupancy) & bishopsQueens) |
+           (Magics::getRookAttack(sq, occupancy) & rooksQueens);
+}
+
+// Is the king of the side that just moved attacked? (used to reject illegal moves)
 bool Board::isInCheck() const
 {
     uint8_t piece = state.side == Color::WHITE ? (int)Piece::k : (int)Piece::K;
     return isSquareAttacked(Bitboard::lsbIndex(pos.pieces[piece]));
 }
 
+// Is the king of the side to move attacked?
+bool Board::sideInCheck() const
+{
+    uint8_t piece = state.side == Color::WHITE ? (int)Piece::K : (int)Piece::k;
+    return isSquareAttacked(Bitboard::lsbIndex(pos.pieces[piece]), state.xside);
+}
+
 void Board::parseFen(const std::string& fen, Board& board)
 {
     int currIndex = 0;
+    board.evalState = EvalState();
 
     // Parse the piece portion of the fen and place them on the board
     for (int rank = 0; rank < 8; rank++) {
@@ -186,6 +257,11 @@ void Board::parseFen(const std::string& fen, Board& board)
     }
     currIndex += 2;
 
+    // Update occupancy bitboards
+    board.pos.updateUnits();
+    // The position was set up from scratch rather than by a move
+    board.evalState.dirty = DirtyPieces();
+
     // Check if king is in check in the initial position
     // If the king is in check, the king has to have a chance to escape it.
     if (board.isInCheck()) {
@@ -235,17 +311,15 @@ void Board::parseFen(const std::string& fen, Board& board)
     // Parse the number of half moves
     std::string spaceInd = fen.substr(currIndex);
     count = spaceInd.find(" ");
-    board.state.halfMoves = atoi(fen.substr(currIndex, count - 1).c_str());
-    currIndex += (int)count;
+    board.state.halfMoves = atoi(fen.substr(currIndex, count).c_str());
+    currIndex += (int)count + 1;
 
     // Parse the number of full moves
     spaceInd = fen.substr(currIndex);
     count = spaceInd.find(" ");
-    board.state.fullMoves = atoi(fen.substr(currIndex, count - 1).c_str());
-
-    // Update occupancy bitboards
-    board.pos.updateUnits();
+    board.state.fullMoves = atoi(fen.substr(currIndex, count).c_str());
 
     board.state.posKey = Zobrist::genKey(board);
     board.state.posLock = Zobrist::genLock(board);
+    board.state.materialKey = Zobrist::genMaterialKey(board);
 }
@@ -0,0 +1,154 @@
+#include "datagen.hpp"
+
+#include "board.hpp"
+#include "material.hpp"
+#include "misc.hpp"
+#include "move.hpp"
+#include "packed.hpp"
+#include "tt.hpp"
+#include "uci.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace Datagen
+{
+
+// Games still going after this many plies are adjudicated as draws
+const int MAX_GAME_PLIES = 400;
+// Openings scored beyond this by the first search are thrown away as too unbalanced
+const int MAX_OPENING_SCORE = 400;
+// Seconds between progress reports
+const int REPORT_INTERVAL = 10;
+
+// State shared by the threads of a run
+struct Shared
+{
+    Packed::Writer writer;
+    std::mutex writerMutex;
+    std::atomic<uint64_t> positions{0};
+    std::atomic<uint64_t> games{0};
+};
+
+// Plays one game into 'positions', keeping the quiet positions only: not in check, and with a
+// best move that is neither a capture nor a promotion, so their scores are close to the
+// static evaluation. Returns UNKNOWN for games thrown away in the opening.
+Packed::Result playGame(const Params& params, std::mt19937_64& rng,
+                        std::vector<Packed::PackedBoard>& positions)
+{
+    positions.clear();
+    Board board;
+    Search::clearKeyHistory();
+    for (int i = 0; i < params.randomPlies; i++) {
+        Move::MoveList legal;
+        Move::generateLegal(legal, board);
+        if (legal.count == 0)
+            return Packed::Result::UNKNOWN;
+        Search::addGameKey(board);
+        Move::make(&board, legal.list[rng() % legal.count], Move::MoveType::allMoves);
+    }
+
+    for (int gamePly = 0;; gamePly++) {
+        Move::MoveList legal;
+        Move::generateLegal(legal, board);
+        if (legal.count == 0) {
+            if (!board.sideInCheck())
+                return Packed::Result::DRAW;
+            return board.state.side == Color::WHITE ? Packed::Result::BLACK_WIN
+                                                    : Packed::Result::WHITE_WIN;
+        }
+        if (board.state.halfMoves >= 100 || Search::isRepetition(board) ||
+            Material::probe(board)->drawn || gamePly >= MAX_GAME_PLIES)
+            return Packed::Result::DRAW;
+
+        Search::SearchResult result = Search::position(board, params.depth, false);
+        if (gamePly == 0 && std::abs(result.score) > MAX_OPENING_SCORE)
+            return Packed::Result::UNKNOWN;
+        int whiteScore = board.state.side == Color::WHITE ? result.score : -result.score;
+        // Mates found by the search end the game
+        if (std::abs(result.score) > Search::MATE_SCORE)
+            return whiteScore > 0 ? Packed::Result::WHITE_WIN : Packed::Result::BLACK_WIN;
+
+        if (!board.sideInCheck() && !Move::isCapture(result.bestMove) &&
+            Move::getPromoted(result.bestMove) == (int)Piece::E)
+            positions.push_back(Packed::pack(board, whiteScore));
+        Search::addGameKey(board);
+        Move::make(&board, result.bestMove, Move::MoveType::allMoves);
+    }
+}
+
+void playGames(const Params& params, const uint64_t seed, Shared& shared)
+{
+    // Search state is thread local; only the transposition table has to be set up
+    TT::Table table((size_t)std::max(params.hashMB, 1) * TT::PER_MB);
+    TT::useTable(&table);
+    UCI::isTimeControlled = false;
+    UCI::nodeLimit = params.nodes;
+
+    std::mt19937_64 rng(seed);
+    std::vector<Packed::PackedBoard> positions;
+    while (shared.positions < params.positions) {
+        std::fill(table.begin(), table.end(), TT::TTEntry());
+        Packed::Result result = playGame(params, rng, positions);
+        if (result == Packed::Result::UNKNOWN)
+            continue;
+        std::lock_guard<std::mutex> lock(shared.writerMutex);
+        uint64_t written = shared.positions;
+        size_t count = (size_t)std::min<uint64_t>(positions.size(), params.positions - written);
+        for (size_t i = 0; i < count; i++) {
+            positions[i].result = result;
+            shared.writer.write(positions[i]);
+        }
+        shared.positions += count;
+        shared.games++;
+    }
+    TT::useTable(nullptr);
+}
+
+void report(const Shared& shared, const int threads, const int64_t elapsed)
+{
+    double seconds = std::max<int64_t>(elapsed, 1) / 1000.0;
+    double perSecond = shared.positions / seconds;
+    std::cout << "positions " << shared.positions << " games " << shared.games << " time "
+              << elapsed << " ms pos/s " << std::fixed << std::setprecision(0) << perSecond
+              << " pos/s/core " << perSecond / threads << std::defaultfloat << "\n";
+}
+
+void run(const Params& params)
+{
+    Shared shared;
+    if (!shared.writer.open(params.outputFile, true)) {
+        std::cout << "Could not open " << params.outputFile << "\n";
+        return;
+    }
+    int threads = std::max(params.threads, 1);
+    uint64_t seed = params.seed ? params.seed : (uint64_t)Time::now();
+    std::cout << "Generating " << params.positions << " positions on " << threads
+              << " threads into " << params.outputFile << "\n";
+
+    int64_t startTime = Time::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++)
+        pool.emplace_back(playGames, std::cref(params), seed + t, std::ref(shared));
+
+    int64_t lastReport = startTime;
+    while (shared.positions < params.positions) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (Time::now() - lastReport >= REPORT_INTERVAL * 1000) {
+            lastReport = Time::now();
+            report(shared, threads, lastReport - startTime);
+        }
+    }
+    for (std::thread& thread : pool)
+        thread.join();
+    shared.writer.close();
+    report(shared, threads, Time::now() - startTime);
+}
+
+} // namespace Datagen
@@ -4,6 +4,13 @@
 #include "bitboard.hpp"
 #include "eval_constants.hpp"
 #include "magics.hpp"
+#include "material.hpp"
+#include "nnue.hpp"
+#include "tt.hpp"
+#include "tt_eval.hpp"
+
+#include <algorithm>
+#include <cstdlib>
 
 namespace Eval
 {
@@ -15,6 +22,8 @@ std::array<std::array<uint64_t, 64>, 2> passedMask;
 std::array<std::array<uint64_t, 64>, 2> outpostMask;
 std::array<KingZone, 64> kingZoneMask;
 
+thread_local EvalStats evalStats;
+
 void setMask(const int rank, const int file, uint64_t &mask)
 {
     if ((rank < 0 && file < 0) || (rank > 7 && file > 7))
@@ -83,8 +92,6 @@ void genKingZones(const int sq)
     if (COL(sq) < 7 && ROW(sq) > 1) {
         setBit(zone, sq - 16 + 1);
     }
-    Bitboard::printBits(zone);
-
     kingZoneMask[sq].innerRing = Attack::kingAttacks[sq];
     setBit(kingZoneMask[sq].innerRing, sq);
     kingZoneMask[sq].outerRing = zone;
@@ -136,243 +143,509 @@ void initMasks()
     }
 }
 
-int EvalPosition(const Board &board)
+int EvalPosition(const Board &board, const int alpha, const int beta)
 {
-    // Don't evaluate position if it's a draw
-    if (isDrawn(board.pos))
-        return DRAW_SCORE;
+    return evaluate<false>(board, alpha, beta, nullptr);
+}
 
-    EvalInfo evalInfo;
-    int sq = 0;
-    Color pieceColor;
-    int16_t phase = board.evalState.phase;
-    uint64_t bitboardCopy = 0;
-    for (int i = (int)Piece::P; i <= (int)Piece::k; i++) {
-        bitboardCopy = board.pos.pieces[i];
-        while (bitboardCopy) {
-            sq = Bitboard::lsbIndex(bitboardCopy);
-            pieceColor = (board.pos.getPieceOnSquare(sq) < 6) ? Color::WHITE : Color::BLACK;
-            switch (COLORLESS(i)) {
-            case (int)PieceTypes::PAWN:
-                evalPawn(board.pos, sq, pieceColor, evalInfo);
-                break;
-            case (int)PieceTypes::KNIGHT:
-                evalKnight(board.pos, sq, pieceColor, evalInfo);
-                break;
-            case (int)PieceTypes::BISHOP:
-                evalBishop(board.pos, sq, pieceColor, evalInfo);
-                break;
-            case (int)PieceTypes::ROOK:
-                evalRook(board.pos, sq, pieceColor, evalInfo);
-                break;
-            case (int)PieceTypes::QUEEN:
-                evalQueen(board.pos, sq, pieceColor, evalInfo);
-                break;
-            default:
-                break;
+int traceEval(const Board &board, EvalTrace &trace)
+{
+    trace = EvalTrace();
+    return evaluate<true>(board, INT_MIN, INT_MAX, &trace);
+}
+
+Score termScore(const int term)
+{
+    if (term < Terms::PSQT)
+        return S(PIECE_VALUES[(int)Phase::MG][term - Terms::PIECE_VALUE],
+                 PIECE_VALUES[(int)Phase::EG][term - Terms::PIECE_VALUE]);
+    if (term < Terms::PASSED_PAWN) {
+        int type = (term - Terms::PSQT) / 64, sq = (term - Terms::PSQT) % 64;
+        return S(PSQT_MG[type][sq], PSQT_EG[type][sq]);
+    }
+    if (term < Terms::MOBILITY)
+        return PASSED_PAWN_PSQT[term - Terms::PASSED_PAWN];
+    if (term < Terms::ISOLATED_PAWN)
+        return PIECE_MOBILITY[term - Terms::MOBILITY];
+    if (term >= Terms::PAWN_SHIELD && term < Terms::PAWN_STORM)
+        return PAWN_SHIELD_BONUS[term - Terms::PAWN_SHIELD];
+    if (term >= Terms::PAWN_STORM && term < Terms::KING_OPEN_FILE)
+        return PAWN_STORM_PENALTY[term - Terms::PAWN_STORM];
+    switch (term) {
+    case Terms::ISOLATED_PAWN:
+        return ISOLATED_PAWN_PENALTY;
+    case Terms::DOUBLED_PAWN:
+        return DOUBLED_PAWN_PENALTY;
+    case Terms::BISHOP_PAIR:
+        return BISHOP_PAIR_BONUS;
+    case Terms::KNIGHT_OUTPOST:
+        return KNIGHT_OUTPOST_BONUS;
+    case Terms::BISHOP_OUTPOST:
+        return BISHOP_OUTPOUT_BONUS;
+    case Terms::ROOK_OR_QUEEN_ON_SEVENTH:
+        return ROOK_OR_QUEEN_ON_SEVENTH_BONUS;
+    case Terms::ROOK_ON_OPEN_FILE:
+        return ROOK_ON_OPEN_FILE_BONUS;
+    case Terms::TEMPO:
+        return TEMPO_BONUS;
+    case Terms::THREAT_BY_PAWN:
+        return THREAT_BY_PAWN;
+    case Terms::KING_OPEN_FILE:
+        return KING_OPEN_FILE_PENALTY;
+    case Terms::KING_SEMI_OPEN_FILE:
+        return KING_SEMI_OPEN_FILE_PENALTY;
+    case Terms::KNIGHT_PAWN_ADJUSTMENT:
+        return KNIGHT_PAWN_ADJUSTMENT;
+    case Terms::ROOK_PAWN_ADJUSTMENT:
+        return ROOK_PAWN_ADJUSTMENT;
+    default:
+        return SCORE_ZERO;
+    }
+}
+
+// Terms printed together by printEval, as [first, last)
+struct TermGroup
+{
+    const char *name;
+    int first, last;
+};
+const std::array<TermGroup, 10> termGroups = {{
+    {"Material", Terms::PIECE_VALUE, Terms::PSQT},
+    {"Piece-square", Terms::PSQT, Terms::PASSED_PAWN},
+    {"Passed pawns", Terms::PASSED_PAWN, Terms::MOBILITY},
+    {"Mobility", Terms::MOBILITY, Terms::ISOLATED_PAWN},
+    {"Pawn structure", Terms::ISOLATED_PAWN, Terms::BISHOP_PAIR},
+    {"Pieces", Terms::BISHOP_PAIR, Terms::TEMPO},
+    {"Tempo", Terms::TEMPO, Terms::THREAT_BY_PAWN},
+    {"Threats", Terms::THREAT_BY_PAWN, Terms::PAWN_SHIELD},
+    {"King shelter", Terms::PAWN_SHIELD, Terms::KNIGHT_PAWN_ADJUSTMENT},
+    {"Imbalance", Terms::KNIGHT_PAWN_ADJUSTMENT, Terms::COUNT},
+}};
+
+void printRow(const char *name, const Score white, const Score black)
+{
+    printf("%16s | %5d %5d | %5d %5d | %5d %5d\n", name, mgValue(white), egValue(white),
+           mgValue(black), egValue(black), mgValue(white - black), egValue(white - black));
+}
+
+void printEval(const Board &board)
+{
+    EvalTrace trace;
+    int eval = traceEval(board, trace);
+    if (board.state.side == Color::BLACK)
+        eval = -eval;
+    if (!trace.complete) {
+        printf("Draw or known ending, evaluation %d (white side)\n", eval);
+        return;
+    }
+
+    printf("            Term |    White    |    Black    |    Total\n");
+    printf("                 |   MG    EG  |   MG    EG  |   MG    EG\n");
+    printf("-----------------+-------------+-------------+------------\n");
+    std::array<Score, 2> total{trace.danger[0], trace.danger[1]};
+    for (const TermGroup &group : termGroups) {
+        std::array<Score, 2> sum{SCORE_ZERO, SCORE_ZERO};
+        for (int term = group.first; term < group.last; term++)
+            for (int clr = (int)Color::WHITE; clr <= (int)Color::BLACK; clr++)
+                sum[clr] += trace.coeffs[term][clr] * termScore(term);
+        printRow(group.name, sum[0], sum[1]);
+        total[0] += sum[0];
+        total[1] += sum[1];
+    }
+    printRow("King danger", trace.danger[0], trace.danger[1]);
+    printf("-----------------+-------------+-------------+------------\n");
+    printRow("Total", total[0], total[1]);
+    printf("\nPhase: %d/256, endgame scale: %d/%d (white), %d/%d (black)\n", trace.phase,
+           trace.scale[0], Material::SCALE_NORMAL, trace.scale[1], Material::SCALE_NORMAL);
+    printf("Evaluation: %d (white side)\n", eval);
+    if (NNUE::enabled()) {
+        int nnueEval = NNUE::evaluate(board);
+        printf("NNUE evaluation: %d (white side)\n",
+               board.state.side == Color::WHITE ? nnueEval : -nnueEval);
+    }
+}
+
+// Adds 'count' times a term's score to a side, and records the count when tracing
+template <bool Trace>
+inline void addTerm(EvalInfo &eInfo, const Color side, const int term, const Score score,
+                    const int count = 1)
+{
+    eInfo.scores[(int)side] += count * score;
+    if constexpr (Trace)
+        eInfo.trace->coeffs[term][(int)side] += count;
+}
+
+// Material, piece-square and material table terms, which the normal evaluation gets from the
+// incremental scores and the material table
+void traceMaterial(const Board &board, EvalTrace &trace)
+{
+    for (int clr = (int)Color::WHITE; clr <= (int)Color::BLACK; clr++) {
+        std::array<int, 6> count{};
+        for (int type = (int)PieceTypes::PAWN; type <= (int)PieceTypes::KING; type++) {
+            uint64_t bitboardCopy = board.pos.pieces[clr * 6 + type];
+            while (bitboardCopy) {
+                int sq = Bitboard::lsbIndex(bitboardCopy);
+                int tableSq = clr == (int)Color::WHITE ? sq : FLIP(sq);
+                if (type != (int)PieceTypes::KING)
+                    trace.coeffs[Terms::PIECE_VALUE + type][clr]++;
+                trace.coeffs[Terms::PSQT + type * 64 + tableSq][clr]++;
+                count[type]++;
+                popBit(bitboardCopy, sq);
             }
-            popBit(bitboardCopy, sq);
         }
+        if (count[(int)PieceTypes::BISHOP] >= 2)
+            trace.coeffs[Terms::BISHOP_PAIR][clr]++;
+        int extraPawns = count[(int)PieceTypes::PAWN] - 5;
+        trace.coeffs[Terms::KNIGHT_PAWN_ADJUSTMENT][clr] +=
+            extraPawns * count[(int)PieceTypes::KNIGHT];
+        trace.coeffs[Terms::ROOK_PAWN_ADJUSTMENT][clr] -= extraPawns * count[(int)PieceTypes::ROOK];
     }
-    if (Bitboard::countBits(board.pos.pieces[(int)Piece::B]) >= 2) {
-        evalInfo.mgScores[(int)Color::WHITE] += BISHOP_PAIR_BONUS[(int)Phase::MG];
-        evalInfo.egScores[(int)Color::WHITE] += BISHOP_PAIR_BONUS[(int)Phase::EG];
+}
+
+template <bool Trace>
+int evaluate(const Board &board, const int alpha, const int beta, EvalTrace *trace)
+{
+    Material::Entry *material;
+    // Tracing may run on several threads, so it keeps away from the shared tables
+    Material::Entry tracedMaterial;
+    if constexpr (Trace) {
+        Material::computeEntry(board, tracedMaterial);
+        material = &tracedMaterial;
+    } else {
+        evalStats.evals++;
+        int cachedEval = TT::Eval::readEntry(board);
+        if (cachedEval != TT::NO_ENTRY) {
+            evalStats.cacheHits++;
+            return cachedEval;
+        }
+        material = Material::probe(board);
     }
-    if (Bitboard::countBits(board.pos.pieces[(int)Piece::b]) >= 2) {
-        evalInfo.mgScores[(int)Color::WHITE] += BISHOP_PAIR_BONUS[(int)Phase::MG];
-        evalInfo.egScores[(int)Color::BLACK] += BISHOP_PAIR_BONUS[(int)Phase::EG];
+
+    // Don't evaluate position if it's a draw
+    if (material->drawn)
+        return DRAW_SCORE;
+    if (material->endgame)
+        return material->endgame(board, *material);
+
+    if constexpr (!Trace) {
+        if (NNUE::enabled()) {
+            int eval = NNUE::evaluate(board);
+            TT::Eval::writeEntry(board, eval);
+            return eval;
+        }
     }
 
-    evalKing(board.pos, Bitboard::lsbIndex(board.pos.pieces[(int)Piece::K]), Color::WHITE,
-             evalInfo);
-    evalKing(board.pos, Bitboard::lsbIndex(board.pos.pieces[(int)Piece::k]), Color::BLACK,
-             evalInfo);
+    EvalInfo evalInfo;
+    evalInfo.trace = trace;
+    // Material and piece-square scores are updated incrementally by Move::make
+    evalInfo.scores = board.evalState.scores;
+    // Bishop pair and imbalance
+    evalInfo.scores[(int)Color::WHITE] += material->scores[(int)Color::WHITE];
+    evalInfo.scores[(int)Color::BLACK] += material->scores[(int)Color::BLACK];
+    addTerm<Trace>(evalInfo, board.state.side, Terms::TEMPO, TEMPO_BONUS);
+
+    if constexpr (Trace) {
+        traceMaterial(board, *trace);
+        trace->phase = material->phase;
+        trace->scale = material->scale;
+        trace->complete = true;
+    } else {
+        // Lazy evaluation
+        // The remaining terms are unlikely to bring a score this far outside the window back in
+        int lazyScore = taper(evalInfo.scores[(int)board.state.side] -
+                                  evalInfo.scores[(int)board.state.xside],
+                              *material, board.state.side);
+        if (lazyScore - LAZY_EVAL_MARGIN >= beta || lazyScore + LAZY_EVAL_MARGIN <= alpha) {
+            evalStats.lazySkips++;
+            return lazyScore;
+        }
+    }
 
-    evalInfo.mgScores[(int)board.state.side] += TEMPO_BONUS_MG;
+    initEvalInfo(board.pos, evalInfo);
 
-    int mgScore =
-        evalInfo.mgScores[(int)board.state.side] - evalInfo.mgScores[(int)board.state.xside];
-    int egScore =
-        evalInfo.egScores[(int)board.state.side] - evalInfo.egScores[(int)board.state.xside];
+    int sq = 0;
+    uint64_t bitboardCopy = 0;
+    for (int clr = (int)Color::WHITE; clr <= (int)Color::BLACK; clr++) {
+        for (int type = (int)PieceTypes::PAWN; type <= (int)PieceTypes::QUEEN; type++) {
+            bitboardCopy = board.pos.pieces[clr * 6 + type];
+            while (bitboardCopy) {
+                sq = Bitboard::lsbIndex(bitboardCopy);
+                switch (type) {
+                case (int)PieceTypes::PAWN:
+                    evalPawn<Trace>(board.pos, sq, (Color)clr, evalInfo);
+                    break;
+                case (int)PieceTypes::KNIGHT:
+                    evalKnight<Trace>(board.pos, sq, (Color)clr, evalInfo);
+                    break;
+                case (int)PieceTypes::BISHOP:
+                    evalBishop<Trace>(board.pos, sq, (Color)clr, evalInfo);
+                    break;
+                case (int)PieceTypes::ROOK:
+                    evalRook<Trace>(board.pos, sq, (Color)clr, evalInfo);
+                    break;
+                case (int)PieceTypes::QUEEN:
+                    evalQueen<Trace>(board.pos, sq, (Color)clr, evalInfo);
+                    break;
+                default:
+                    break;
+                }
+                popBit(bitboardCopy, sq);
+            }
+        }
+    }
+    // Every attack map is complete from here on
+    for (int clr = (int)Color::WHITE; clr <= (int)Color::BLACK; clr++)
+        for (uint64_t attacks : evalInfo.attackedBy[clr])
+            evalInfo.attacked[clr] |= attacks;
+
+    evalThreats<Trace>(board.pos, Color::WHITE, evalInfo);
+    evalThreats<Trace>(board.pos, Color::BLACK, evalInfo);
+    evalKing<Trace>(board.pos, evalInfo.kingSquares[(int)Color::WHITE], Color::WHITE, evalInfo);
+    evalKing<Trace>(board.pos, evalInfo.kingSquares[(int)Color::BLACK], Color::BLACK, evalInfo);
+
+    int eval = taper(evalInfo.scores[(int)board.state.side] -
+                         evalInfo.scores[(int)board.state.xside],
+                     *material, board.state.side);
+    // Lazy scores are only bounds, so only full evaluations are cached
+    if constexpr (!Trace)
+        TT::Eval::writeEntry(board, eval);
+    return eval;
+}
 
-    phase = ((phase * 256) + (TOTAL_PHASE / 2)) / TOTAL_PHASE;
+// Interpolate a score from the side to move's point of view between the middlegame and the
+// endgame
+int taper(const Score score, const Material::Entry &material, const Color side)
+{
+    int mgScore = mgValue(score);
+    int egScore = egValue(score);
+    // Scale down endgame advantages that are hard to convert
+    int ahead = egScore > 0 ? (int)side : (int)side ^ 1;
+    egScore = egScore * material.scale[ahead] / Material::SCALE_NORMAL;
 
+    int phase = material.phase;
     return (((mgScore * (256 - phase)) + (egScore * phase)) / 256);
 }
 
+void initEvalInfo(const Position &pos, EvalInfo &eInfo)
+{
+    for (int clr = (int)Color::WHITE; clr <= (int)Color::BLACK; clr++) {
+        eInfo.kingSquares[clr] = Bitboard::lsbIndex(pos.pieces[clr * 6 + (int)PieceTypes::KING]);
+        eInfo.pawnAttacks[clr] =
+            Attack::pawnSetAttacks((Color)clr, pos.pieces[clr * 6 + (int)PieceTypes::PAWN]);
+        eInfo.attackedBy[clr][(int)PieceTypes::PAWN] = eInfo.pawnAttacks[clr];
+        eInfo.attackedBy[clr][(int)PieceTypes::KING] = Attack::kingAttacks[eInfo.kingSquares[clr]];
+        eInfo.kingZones[clr] = kingZoneMask[eInfo.kingSquares[clr]];
+    }
+    for (int clr = (int)Color::WHITE; clr <= (int)Color::BLACK; clr++)
+        eInfo.mobilityArea[clr] = ~(pos.pieces[clr * 6 + (int)PieceTypes::PAWN] |
+                                    pos.pieces[clr * 6 + (int)PieceTypes::KING] |
+                                    eInfo.pawnAttacks[clr ^ 1]);
+}
+
+template <bool Trace>
 void evalPawn(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo)
 {
     uint8_t sidePawn = pieceColor == Color::WHITE ? (int)Piece::P : (int)Piece::p;
     uint8_t xsidePawn = pieceColor == Color::WHITE ? (int)Piece::p : (int)Piece::P;
     // Isolated pawns penalty
-    if ((isolatedMask[COL(sq)] & pos.pieces[sidePawn]) == 0) {
-        eInfo.mgScores[(int)pieceColor] -= ISOLATED_PAWN_PENALTY[(int)Phase::MG];
-        eInfo.egScores[(int)pieceColor] -= ISOLATED_PAWN_PENALTY[(int)Phase::EG];
-    }
+    if ((isolatedMask[COL(sq)] & pos.pieces[sidePawn]) == 0)
+        addTerm<Trace>(eInfo, pieceColor, Terms::ISOLATED_PAWN, ISOLATED_PAWN_PENALTY, -1);
     // Doubled pawns penalty
     auto doubledPawnCount = (uint8_t)Bitboard::countBits(pos.pieces[sidePawn] & fileMask[COL(sq)]);
-    if (doubledPawnCount > 1) {
-        eInfo.mgScores[(int)pieceColor] -= DOUBLED_PAWN_PENALTY[(int)Phase::MG];
-        eInfo.egScores[(int)pieceColor] -= DOUBLED_PAWN_PENALTY[(int)Phase::EG];
-    }
+    if (doubledPawnCount > 1)
+        addTerm<Trace>(eInfo, pieceColor, Terms::DOUBLED_PAWN, DOUBLED_PAWN_PENALTY, -1);
     // Passed pawns bonus
     // Give passed pawn bonus for non doubled pawns
     if (((passedMask[(int)pieceColor][sq] & pos.pieces[xsidePawn]) == 0) &&
-        (doubledPawnCount == 0)) {
-        eInfo.mgScores[(int)pieceColor] += PASSED_PAWN_PSQT[(int)Phase::MG][sq];
-        eInfo.egScores[(int)pieceColor] += PASSED_PAWN_PSQT[(int)Phase::EG][sq];
+        (doubledPawnCount == 1)) {
+        int tableSq = pieceColor == Color::WHITE ? sq : FLIP(sq);
+        addTerm<Trace>(eInfo, pieceColor, Terms::PASSED_PAWN + tableSq, PASSED_PAWN_PSQT[tableSq]);
     }
 }
 
+template <bool Trace>
 void evalKnight(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo)
 {
-    uint64_t sidePawn =
-        pieceColor == Color::WHITE ? pos.pieces[(int)Piece::P] : pos.pieces[(int)Piece::p];
     uint64_t xsidePawn =
         pieceColor == Color::WHITE ? pos.pieces[(int)Piece::p] : pos.pieces[(int)Piece::P];
-    auto xside = (Color)((int)pieceColor ^ 1);
     int rankFromSidePOV = pieceColor == Color::WHITE ? ROW(sq) : ROW(FLIP(sq));
 
     // Outpost bonus
     if (((outpostMask[(int)pieceColor][sq] & xsidePawn) == 0) &&
-        ((Attack::pawnAttacks[(int)xside][sq] & sidePawn) != 0) && rankFromSidePOV < 4) {
-        eInfo.mgScores[(int)pieceColor] += KNIGHT_OUTPOST_BONUS[(int)Phase::MG];
-        eInfo.egScores[(int)pieceColor] += KNIGHT_OUTPOST_BONUS[(int)Phase::EG];
-    }
+        getBit(eInfo.pawnAttacks[(int)pieceColor], sq) && rankFromSidePOV < 4)
+        addTerm<Trace>(eInfo, pieceColor, Terms::KNIGHT_OUTPOST, KNIGHT_OUTPOST_BONUS);
     // Mobility bonus
-    uint64_t allMoves = Attack::knightAttacks[sq] & ~pos.units[(int)pieceColor];
-    uint64_t safeMoves = allMoves;
-    int bitInd = 0;
-    while (xsidePawn) {
-        bitInd = Bitboard::lsbIndex(xsidePawn);
-        safeMoves &= ~Attack::pawnAttacks[(int)xside][bitInd];
-        popBit(xsidePawn, bitInd);
-    }
-    int mobility = Bitboard::countBits(safeMoves);
-    eInfo.mgScores[(int)pieceColor] +=
-        (mobility - 4) * PIECE_MOBILITY[(int)Phase::MG][(int)PieceTypes::KNIGHT];
-    eInfo.egScores[(int)pieceColor] +=
-        (mobility - 4) * PIECE_MOBILITY[(int)Phase::EG][(int)PieceTypes::KNIGHT];
+    uint64_t attacks = Attack::knightAttacks[sq];
+    eInfo.attackedBy[(int)pieceColor][(int)PieceTypes::KNIGHT] |= attacks;
+    addKingAttacks(pieceColor, PieceTypes::KNIGHT, attacks, eInfo);
+    int mobility = Bitboard::countBits(attacks & eInfo.mobilityArea[(int)pieceColor]);
+    addTerm<Trace>(eInfo, pieceColor, Terms::MOBILITY + (int)PieceTypes::KNIGHT,
+                   PIECE_MOBILITY[(int)PieceTypes::KNIGHT], mobility - 4);
 }
 
+template <bool Trace>
 void evalBishop(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo)
 {
-    uint64_t sidePawn =
-        pieceColor == Color::WHITE ? pos.pieces[(int)Piece::P] : pos.pieces[(int)Piece::p];
     uint64_t xsidePawn =
         pieceColor == Color::WHITE ? pos.pieces[(int)Piece::p] : pos.pieces[(int)Piece::P];
-    auto xside = (Color)((int)pieceColor ^ 1);
     int rankFromSidePOV = pieceColor == Color::WHITE ? ROW(sq) : ROW(FLIP(sq));
 
     // Outpost bonus
     if (((outpostMask[(int)pieceColor][sq] & xsidePawn) == 0) &&
-        ((Attack::pawnAttacks[(int)xside][sq] & sidePawn) != 0) && rankFromSidePOV < 4) {
-        eInfo.mgScores[(int)pieceColor] += BISHOP_OUTPOUT_BONUS[(int)Phase::MG];
-        eInfo.egScores[(int)pieceColor] += BISHOP_OUTPOUT_BONUS[(int)Phase::EG];
-    }
+        getBit(eInfo.pawnAttacks[(int)pieceColor], sq) && rankFromSidePOV < 4)
+        addTerm<Trace>(eInfo, pieceColor, Terms::BISHOP_OUTPOST, BISHOP_OUTPOUT_BONUS);
     // Mobility bonus
-    uint64_t safeMoves =
-        Magics::getBishopAttack(sq, pos.units[(int)Color::BOTH]) & ~pos.units[(int)pieceColor];
-
-    int mobility = Bitboard::countBits(safeMoves);
-    eInfo.mgScores[(int)pieceColor] +=
-        (mobility - 7) * PIECE_MOBILITY[(int)Phase::MG][(int)PieceTypes::BISHOP];
-    eInfo.egScores[(int)pieceColor] +=
-        (mobility - 7) * PIECE_MOBILITY[(int)Phase::EG][(int)PieceTypes::BISHOP];
+    uint64_t attacks = Magics::getBishopAttack(sq, pos.units[(int)Color::BOTH]);
+    eInfo.attackedBy[(int)pieceColor][(int)PieceTypes::BISHOP] |= attacks;
+    addKingAttacks(pieceColor, PieceTypes::BISHOP, attacks, eInfo);
+    int mobility = Bitboard::countBits(attacks & eInfo.mobilityArea[(int)pieceColor]);
+    addTerm<Trace>(eInfo, pieceColor, Terms::MOBILITY + (int)PieceTypes::BISHOP,
+                   PIECE_MOBILITY[(int)PieceTypes::BISHOP], mobility - 7);
 }
 
+template <bool Trace>
 void evalRook(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo)
 {
-    Color xside = pieceColor == Color::WHITE ? Color::BLACK : Color::WHITE;
-    int enemyKingSq = Bitboard::lsbIndex(
-        pos.pieces[(pieceColor == Color::WHITE) ? (int)Piece::k : (int)Piece::K]);
+    int enemyKingSq = eInfo.kingSquares[(int)pieceColor ^ 1];
     int rankFromSidePOV = pieceColor == Color::WHITE ? ROW(sq) : ROW(FLIP(sq));
     int enemyKingRankFromSidePOV =
         pieceColor == Color::WHITE ? ROW(enemyKingSq) : ROW(FLIP(enemyKingSq));
     // Bonus for if the rook is on the seventh rank and cuts off the king from the rest of the board
     if (rankFromSidePOV == 1 && enemyKingRankFromSidePOV <= 1)
-        eInfo.egScores[(int)pieceColor] += ROOK_OR_QUEEN_ON_SEVENTH_BONUS_EG;
+        addTerm<Trace>(eInfo, pieceColor, Terms::ROOK_OR_QUEEN_ON_SEVENTH,
+                       ROOK_OR_QUEEN_ON_SEVENTH_BONUS);
 
     // If the rook on an open file (If file not blocked by any pawn)
     if ((fileMask[COL(sq)] & (pos.pieces[(int)Piece::P] | pos.pieces[(int)Piece::p])) == 0)
-        eInfo.mgScores[(int)pieceColor] += ROOK_ON_OPEN_FILE_BONUS_MG;
+        addTerm<Trace>(eInfo, pieceColor, Terms::ROOK_ON_OPEN_FILE, ROOK_ON_OPEN_FILE_BONUS);
 
     // Mobility bonus
-    uint64_t safeMoves =
-        Magics::getRookAttack(sq, pos.units[(int)Color::BOTH]) & ~pos.units[(int)pieceColor];
-
-    int mobility = Bitboard::countBits(safeMoves);
-    eInfo.mgScores[(int)pieceColor] +=
-        (mobility - 7) * PIECE_MOBILITY[(int)Phase::MG][(int)PieceTypes::ROOK];
-    eInfo.egScores[(int)pieceColor] +=
-        (mobility - 7) * PIECE_MOBILITY[(int)Phase::EG][(int)PieceTypes::ROOK];
+    uint64_t attacks = Magics::getRookAttack(sq, pos.units[(int)Color::BOTH]);
+    eInfo.attackedBy[(int)pieceColor][(int)PieceTypes::ROOK] |= attacks;
+    addKingAttacks(pieceColor, PieceTypes::ROOK, attacks, eInfo);
+    int mobility = Bitboard::countBits(attacks & eInfo.mobilityArea[(int)pieceColor]);
+    addTerm<Trace>(eInfo, pieceColor, Terms::MOBILITY + (int)PieceTypes::ROOK,
+                   PIECE_MOBILITY[(int)PieceTypes::ROOK], mobility - 7);
 }
 
+template <bool Trace>
 void evalQueen(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo)
 {
-    Color xside = pieceColor == Color::WHITE ? Color::BLACK : Color::WHITE;
-    int enemyKingSq = Bitboard::lsbIndex(
-        pos.pieces[(pieceColor == Color::WHITE) ? (int)Piece::k : (int)Piece::K]);
+    int enemyKingSq = eInfo.kingSquares[(int)pieceColor ^ 1];
     int rankFromSidePOV = pieceColor == Color::WHITE ? ROW(sq) : ROW(FLIP(sq));
     int enemyKingRankFromSidePOV =
         pieceColor == Color::WHITE ? ROW(enemyKingSq) : ROW(FLIP(enemyKingSq));
     // Bonus for if the rook is on the seventh rank and cuts off the king from the rest of the board
     if (rankFromSidePOV == 1 && enemyKingRankFromSidePOV <= 1)
-        eInfo.egScores[(int)pieceColor] += ROOK_OR_QUEEN_ON_SEVENTH_BONUS_EG;
+        addTerm<Trace>(eInfo, pieceColor, Terms::ROOK_OR_QUEEN_ON_SEVENTH,
+                       ROOK_OR_QUEEN_ON_SEVENTH_BONUS);
 
     // Mobility bonus
-    uint64_t safeMoves =
-        Magics::getQueenAttack(sq, pos.units[(int)Color::BOTH]) & ~pos.units[(int)pieceColor];
-
-    int mobility = Bitboard::countBits(safeMoves);
-    eInfo.mgScores[(int)pieceColor] +=
-        (mobility - 14) * PIECE_MOBILITY[(int)Phase::MG][(int)PieceTypes::QUEEN];
-    eInfo.egScores[(int)pieceColor] +=
-        (mobility - 14) * PIECE_MOBILITY[(int)Phase::EG][(int)PieceTypes::QUEEN];
+    uint64_t attacks = Magics::getQueenAttack(sq, pos.units[(int)Color::BOTH]);
+    eInfo.attackedBy[(int)pieceColor][(int)PieceTypes::QUEEN] |= attacks;
+    addKingAttacks(pieceColor, PieceTypes::QUEEN, attacks, eInfo);
+    int mobility = Bitboard::countBits(attacks & eInfo.mobilityArea[(int)pieceColor]);
+    addTerm<Trace>(eInfo, pieceColor, Terms::MOBILITY + (int)PieceTypes::QUEEN,
+                   PIECE_MOBILITY[(int)PieceTypes::QUEEN], mobility - 14);
 }
 
-void evalKing(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo) {}
+// Pieces attacked by enemy pawns
+template <bool Trace>
+void evalThreats(const Position &pos, const Color side, EvalInfo &eInfo)
+{
+    int xside = (int)side ^ 1;
+    uint64_t nonPawnPieces =
+        pos.units[xside] & ~pos.pieces[xside * 6 + (int)PieceTypes::PAWN] &
+        ~pos.pieces[xside * 6 + (int)PieceTypes::KING];
+    addTerm<Trace>(eInfo, side, Terms::THREAT_BY_PAWN, THREAT_BY_PAWN,
+                   Bitboard::countBits(eInfo.pawnAttacks[(int)side] & nonPawnPieces));
+}
 
-bool isDrawn(const Position &pos)
+// Count a piece that attacks the enemy king zone
+void addKingAttacks(const Color side, const PieceTypes type, const uint64_t attacks,
+                    EvalInfo &eInfo)
 {
-    std::array<std::array<uint8_t, 6>, 2> count;
-    // White piece count excluding the king
-    count[0][0] = (uint8_t)Bitboard::countBits(pos.pieces[(int)Piece::P]);
-    count[0][1] = (uint8_t)Bitboard::countBits(pos.pieces[(int)Piece::N]);
-    count[0][2] = (uint8_t)Bitboard::countBits(pos.pieces[(int)Piece::B]);
-    count[0][3] = (uint8_t)Bitboard::countBits(pos.pieces[(int)Piece::R]);
-    count[0][4] = (uint8_t)Bitboard::countBits(pos.pieces[(int)Piece::Q]);
-
-    // Black piece count excluding the king
-    count[1][0] = (uint8_t)Bitboard::countBits(pos.pieces[(int)Piece::p]);
-    count[1][1] = (uint8_t)Bitboard::countBits(pos.pieces[(int)Piece::n]);
-    count[1][2] = (uint8_t)Bitboard::countBits(pos.pieces[(int)Piece::b]);
-    count[1][3] = (uint8_t)Bitboard::countBits(pos.pieces[(int)Piece::r]);
-    count[1][4] = (uint8_t)Bitboard::countBits(pos.pieces[(int)Piece::q]);
-
-    // Piece count for both colors
-    uint8_t majorCount = (count[0][3] + count[0][4]) + (count[1][3] + count[1][4]);
-    uint8_t minorCount = (count[0][1] + count[0][2]) + (count[1][1] + count[1][2]);
-    uint8_t pawnCount = (count[0][0] + count[1][0]);
-
-    if (pawnCount == 0 && majorCount == 0 && minorCount == 0) {
-        // K vs K position
-        return true;
-    } else if (majorCount + pawnCount == 0) {
-        // Minor piece endgame
-        if (minorCount == 1)
-            // KB vs K; KN vs K
-            return true;
-        else if (minorCount == 2 && count[0][1] == 1 && count[1][1] == 1)
-            // KN vs KN
-            return true;
-        else if (minorCount == 2 && count[0][2] == 1 && count[1][2] == 1) {
-            auto whiteBishopSquare = (uint8_t)Bitboard::lsbIndex(pos.pieces[(int)Piece::B]);
-            auto blackBishopSquare = (uint8_t)Bitboard::lsbIndex(pos.pieces[(int)Piece::b]);
-            return SQCLR(ROW(whiteBishopSquare), COL(whiteBishopSquare)) ==
-                   SQCLR(ROW(blackBishopSquare), COL(blackBishopSquare));
+    const KingZone &zone = eInfo.kingZones[(int)side ^ 1];
+    uint64_t zoneAttacks = attacks & (zone.innerRing | zone.outerRing);
+    if (zoneAttacks == 0)
+        return;
+    eInfo.kingAttackers[(int)side]++;
+    eInfo.kingAttackPoints[(int)side] +=
+        KING_ATTACK_WEIGHTS[(int)type] * Bitboard::countBits(zoneAttacks);
+}
+
+template <bool Trace>
+void evalKing(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo)
+{
+    int side = (int)pieceColor, xside = side ^ 1;
+    uint64_t sidePawn = pos.pieces[side * 6 + (int)PieceTypes::PAWN];
+    uint64_t xsidePawn = pos.pieces[xside * 6 + (int)PieceTypes::PAWN];
+
+    // Pawn shield, pawn storm and open files on the king file and the files next to it
+    int kingRow = ROW(sq);
+    // Ranks in front of the king from its side's point of view
+    uint64_t inFront;
+    if (pieceColor == Color::WHITE)
+        inFront = (1ULL << (8 * kingRow)) - 1;
+    else
+        inFront = kingRow == 7 ? 0ULL : ~((1ULL << (8 * (kingRow + 1))) - 1);
+    for (int f = std::max(COL(sq) - 1, 0); f <= std::min(COL(sq) + 1, 7); f++) {
+        uint64_t shield = sidePawn & fileMask[f] & inFront;
+        uint64_t storm = xsidePawn & fileMask[f] & inFront;
+        if (shield) {
+            int closest = pieceColor == Color::WHITE ? Bitboard::msbIndex(shield)
+                                                     : Bitboard::lsbIndex(shield);
+            int distance = std::abs(ROW(closest) - kingRow);
+            addTerm<Trace>(eInfo, pieceColor, Terms::PAWN_SHIELD + distance,
+                           PAWN_SHIELD_BONUS[distance]);
+        } else if ((sidePawn & fileMask[f]) == 0) {
+            if (xsidePawn & fileMask[f])
+                addTerm<Trace>(eInfo, pieceColor, Terms::KING_SEMI_OPEN_FILE,
+                               KING_SEMI_OPEN_FILE_PENALTY, -1);
+            else
+                addTerm<Trace>(eInfo, pieceColor, Terms::KING_OPEN_FILE, KING_OPEN_FILE_PENALTY,
+                               -1);
+        }
+        if (storm) {
+            int closest = pieceColor == Color::WHITE ? Bitboard::msbIndex(storm)
+                                                     : Bitboard::lsbIndex(storm);
+            int distance = std::abs(ROW(closest) - kingRow);
+            addTerm<Trace>(eInfo, pieceColor, Terms::PAWN_STORM + distance,
+                           PAWN_STORM_PENALTY[distance], -1);
         }
     }
-    return false;
+
+    // Attacks on the king zone
+    if (eInfo.kingAttackers[xside] == 0)
+        return;
+    int danger = eInfo.kingAttackPoints[xside] *
+                 ATTACKER_COUNT_SCALE[std::min<int>(eInfo.kingAttackers[xside], 7)] / 100;
+
+    // Squares next to the king that the enemy attacks and only the king defends
+    uint64_t defended = eInfo.attacked[side] & ~eInfo.attackedBy[side][(int)PieceTypes::KING];
+    uint64_t weak = Attack::kingAttacks[sq] & eInfo.attacked[xside] & ~defended;
+    danger += WEAK_KING_SQUARE_WEIGHT * Bitboard::countBits(weak);
+
+    // Checks the enemy can give on squares this side doesn't control
+    uint64_t safe = ~pos.units[xside] & ~eInfo.attacked[side];
+    uint64_t rookLines = Magics::getRookAttack(sq, pos.units[(int)Color::BOTH]);
+    uint64_t bishopLines = Magics::getBishopAttack(sq, pos.units[(int)Color::BOTH]);
+    const auto &attackedBy = eInfo.attackedBy[xside];
+    if (Attack::knightAttacks[sq] & attackedBy[(int)PieceTypes::KNIGHT] & safe)
+        danger += SAFE_CHECK_WEIGHTS[(int)PieceTypes::KNIGHT];
+    if (bishopLines & attackedBy[(int)PieceTypes::BISHOP] & safe)
+        danger += SAFE_CHECK_WEIGHTS[(int)PieceTypes::BISHOP];
+    if (rookLines & attackedBy[(int)PieceTypes::ROOK] & safe)
+        danger += SAFE_CHECK_WEIGHTS[(int)PieceTypes::ROOK];
+    if ((rookLines | bishopLines) & attackedBy[(int)PieceTypes::QUEEN] & safe)
+        danger += SAFE_CHECK_WEIGHTS[(int)PieceTypes::QUEEN];
+
+    // Attacks without the queen rarely get through
+    if (pos.pieces[xside * 6 + (int)PieceTypes::QUEEN] == 0)
+        danger /= 2;
+    eInfo.scores[side] -= S(danger, danger / 8);
+    if constexpr (Trace)
+        eInfo.trace->danger[side] -= S(danger, danger / 8);
 }
+
 } // namespace Eval
\ No newline at end of file
@@ -3,9 +3,9 @@
 namespace Eval
 {
 
-const std::array<std::array<int16_t, 6>, 2> PIECE_VALUES = {
+constexpr std::array<std::array<int16_t, 6>, 2> PIECE_VALUES = {
     {{84, 333, 346, 441, 921}, {106, 244, 268, 478, 886}}};
-const std::array<std::array<int8_t, 5>, 2> PIECE_MOBILITY = {{{0, 5, 3, 3, 0}, {0, 2, 3, 2, 6}}};
+const std::array<Score, 5> PIECE_MOBILITY = {S(0, 0), S(5, 2), S(3, 3), S(3, 2), S(0, 6)};
 
 const int8_t DRAW_SCORE = 0;
 
@@ -21,18 +21,41 @@ const std::array<int8_t, 6> PHASE_VALUES = {PAWN_PHASE, KNIGHT_PHASE, BISHOP_PHA
                                             QUEEN_PHASE, 0};
 
 // Penalties
-const std::array<int8_t, 2> ISOLATED_PAWN_PENALTY = {17, 6};
-const std::array<int8_t, 2> DOUBLED_PAWN_PENALTY = {1, 16};
+const Score ISOLATED_PAWN_PENALTY = S(17, 6);
+const Score DOUBLED_PAWN_PENALTY = S(1, 16);
 
 // Bonuses
-const std::array<int8_t, 2> BISHOP_PAIR_BONUS = {22, 30};
-const std::array<int8_t, 2> KNIGHT_OUTPOST_BONUS = {27, 18};
-const std::array<int8_t, 2> BISHOP_OUTPOUT_BONUS = {10, 14};
-const int8_t ROOK_OR_QUEEN_ON_SEVENTH_BONUS_EG = 23;
-const int8_t ROOK_ON_OPEN_FILE_BONUS_MG = 23;
-const int8_t TEMPO_BONUS_MG = 14;
+const Score BISHOP_PAIR_BONUS = S(22, 30);
+const Score KNIGHT_OUTPOST_BONUS = S(27, 18);
+const Score BISHOP_OUTPOUT_BONUS = S(10, 14);
+const Score ROOK_OR_QUEEN_ON_SEVENTH_BONUS = S(0, 23);
+const Score ROOK_ON_OPEN_FILE_BONUS = S(23, 0);
+const Score TEMPO_BONUS = S(14, 0);
+const Score THREAT_BY_PAWN = S(40, 25);
 
-const std::array<std::array<int16_t, 64>, 6> PSQT_MG = {{
+// King safety
+// Danger per king zone square attacked, by piece type
+const std::array<int8_t, 5> KING_ATTACK_WEIGHTS = {0, 10, 8, 12, 20};
+// Percentage of the attack danger that counts, by number of attackers
+const std::array<int8_t, 8> ATTACKER_COUNT_SCALE = {0, 0, 50, 75, 88, 94, 97, 99};
+// Danger of a check the enemy can give without losing the checking piece, by piece type
+const std::array<int8_t, 5> SAFE_CHECK_WEIGHTS = {0, 40, 25, 40, 35};
+// Danger per square next to the king that is attacked and only defended by the king
+const int8_t WEAK_KING_SQUARE_WEIGHT = 8;
+// By distance from the king to the closest pawn in front of it, on the king file or next to it
+const std::array<Score, 8> PAWN_SHIELD_BONUS = {S(0, 0),  S(24, 0), S(12, 0), S(4, 0),
+                                                S(0, 0),  S(0, 0),  S(0, 0),  S(0, 0)};
+const std::array<Score, 8> PAWN_STORM_PENALTY = {S(0, 0),  S(10, 0), S(30, 0), S(15, 0),
+                                                 S(5, 0),  S(0, 0),  S(0, 0),  S(0, 0)};
+// Files next to the king without friendly pawns, with and without enemy pawns
+const Score KING_OPEN_FILE_PENALTY = S(25, 0);
+const Score KING_SEMI_OPEN_FILE_PENALTY = S(12, 0);
+
+// Imbalance, per own pawn above five
+const Score KNIGHT_PAWN_ADJUSTMENT = S(4, 6);
+const Score ROOK_PAWN_ADJUSTMENT = S(8, 12);
+
+constexpr std::array<std::array<int16_t, 64>, 6> PSQT_MG = {{
     {
         // MG Pawn PST
         0,   0,   0,   0,   0,   0,  0,   0,   45,  52,  42,  43,  28, 34, 19, 9,
@@ -76,7 +99,7 @@ const std::array<std::array<int16_t, 64>, 6> PSQT_MG = {{
     },
 }};
 
-const std::array<std::array<int16_t, 64>, 6> PSQT_EG = {{
+constexpr std::array<std::array<int16_t, 64>, 6> PSQT_EG = {{
     {
         // EG Pawn PST
         0,   0,   0,   0,   0,   0,   0,   0,   77,  74,  63,  53,  59,  60,  72,  77,
@@ -120,17 +143,33 @@ const std::array<std::array<int16_t, 64>, 6> PSQT_EG = {{
     },
 }};
 
-const std::array<std::array<int8_t, 64>, 2> PASSED_PAWN_PSQT = {{
-    {
-        0,  0,  0,  0,  0,  0,  0,  0,  45, 52, 42, 43, 28, 34, 19,  9,  48, 43, 43, 30, 24, 31,
-        12, 2,  28, 17, 13, 10, 10, 19, 6,  1,  14, 0,  -9, -7, -13, -7, 9,  16, 5,  3,  -3, -14,
-        -3, 10, 13, 19, 8,  9,  2,  -8, -3, 8,  16, 9,  0,  0,  0,   0,  0,  0,  0,  0,
-    },
-    {
-        0,  0,  0,  0,  0,  0,  0,  0,  77, 74, 63, 53, 59, 60, 72, 77, 91, 83, 66, 40, 30, 61,
-        67, 84, 55, 52, 42, 35, 30, 34, 56, 52, 29, 26, 21, 18, 17, 19, 34, 30, 8,  6,  5,  1,
-        1,  -1, 14, 7,  2,  3,  -4, 0,  -2, -1, 7,  6,  0,  0,  0,  0,  0,  0,  0,  0,
-    },
-}};
+const std::array<Score, 64> PASSED_PAWN_PSQT = {
+    S(0, 0), S(0, 0), S(0, 0), S(0, 0), S(0, 0), S(0, 0), S(0, 0), S(0, 0),
+    S(45, 77), S(52, 74), S(42, 63), S(43, 53), S(28, 59), S(34, 60), S(19, 72), S(9, 77),
+    S(48, 91), S(43, 83), S(43, 66), S(30, 40), S(24, 30), S(31, 61), S(12, 67), S(2, 84),
+    S(28, 55), S(17, 52), S(13, 42), S(10, 35), S(10, 30), S(19, 34), S(6, 56), S(1, 52),
+    S(14, 29), S(0, 26), S(-9, 21), S(-7, 18), S(-13, 17), S(-7, 19), S(9, 34), S(16, 30),
+    S(5, 8), S(3, 6), S(-3, 5), S(-14, 1), S(-3, 1), S(10, -1), S(13, 14), S(19, 7),
+    S(8, 2), S(9, 3), S(2, -4), S(-8, 0), S(-3, -2), S(8, -1), S(16, 7), S(9, 6),
+    S(0, 0), S(0, 0), S(0, 0), S(0, 0), S(0, 0), S(0, 0), S(0, 0), S(0, 0),
+};
+
+// Fused at compile time so that boards constructed during static initialization can use it
+constexpr std::array<std::array<Score, 64>, 12> fusePSQ()
+{
+    std::array<std::array<Score, 64>, 12> table{};
+    for (int piece = (int)Piece::P; piece <= (int)Piece::k; piece++) {
+        int type = COLORLESS(piece);
+        for (int sq = 0; sq < 64; sq++) {
+            // The tables are laid out from white's point of view
+            int tableSq = piece < (int)Piece::p ? sq : FLIP(sq);
+            table[piece][sq] = S(PIECE_VALUES[(int)Phase::MG][type] + PSQT_MG[type][tableSq],
+                                 PIECE_VALUES[(int)Phase::EG][type] + PSQT_EG[type][tableSq]);
+        }
+    }
+    return table;
+}
+
+constexpr std::array<std::array<Score, 64>, 12> psq = fusePSQ();
 
 } // namespace Eval
\ No newline at end of file
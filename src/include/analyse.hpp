@@ -0,0 +1,32 @@
+#pragma once
+
+#include "defs.hpp"
+#include "search.hpp"
+
+#include <string>
+
+// Offline analysis of a file of positions on a pool of workers, each running its own search
+// with its own transposition table; results are written in input order
+namespace Analyse
+{
+
+enum class Format { CSV, JSON };
+
+struct Params
+{
+    // EPD/FEN lines, or packed records if the name ends in ".bin"
+    std::string inputFile;
+    std::string outputFile;
+    Format format = Format::CSV;
+    // Search limit of every position: a depth, a node count or a time in ms
+    int depth = Search::MAX_PLY;
+    uint64_t nodes = 0;
+    int moveTime = 0;
+    int threads = 1;
+    // Transposition table of every worker, in MB; it is kept between positions
+    int hashMB = 16;
+};
+
+void run(const Params& params);
+
+} // namespace Analyse
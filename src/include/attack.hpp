@@ -13,6 +13,16 @@ extern std::array<std::array<uint64_t, 4096>, 64> rookAttacks;   // [square][occ
 extern const std::array<int, 64> bishopRelevantBits;            // [square]
 extern const std::array<int, 64> rookRelevantBits;              // [square]
 
+// Squares attacked by a set of pawns, computed with two shifts instead of per pawn
+inline uint64_t pawnSetAttacks(const Color side, const uint64_t pawns)
+{
+    constexpr uint64_t notAFile = ~0x0101010101010101ULL;
+    constexpr uint64_t notHFile = ~0x8080808080808080ULL;
+    if (side == Color::WHITE)
+        return ((pawns >> 7) & notAFile) | ((pawns >> 9) & notHFile);
+    return ((pawns << 7) & notHFile) | ((pawns << 9) & notAFile);
+}
+
 // Prototypes
 void init();
 void initLeapers();
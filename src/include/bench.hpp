@@ -0,0 +1,15 @@
+#pragma once
+
+#include "board.hpp"
+#include "defs.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Bench {
+extern const std::vector<std::string> positions;
+
+void search(const int depth);
+void eval(const int passes);
+void nnue(const int passes);
+} // namespace Bench
@@ -2,6 +2,8 @@
 
 #include "defs.hpp"
 
+#include <bit>
+
 namespace Bitboard {
 
 void printBits(const uint64_t bitboard);
@@ -15,5 +17,8 @@ inline int countBits(uint64_t bitboard) {
 inline int lsbIndex(const uint64_t bitboard) {
     return bitboard > 0 ? countBits(bitboard ^ (bitboard - 1)) - 1 : 0;
 }
+inline int msbIndex(const uint64_t bitboard) {
+    return bitboard > 0 ? std::bit_width(bitboard) - 1 : 0;
+}
 
 } // namespace Bitboard
\ No newline at end of file
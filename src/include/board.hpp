@@ -28,6 +28,8 @@ struct State
     int halfMoves = 0;
     uint64_t posKey = 0ULL;
     uint64_t posLock = 0ULL;
+    // Hash of the piece counts
+    uint64_t materialKey = 0ULL;
 
     State() = default;
     inline void changeSide()
@@ -37,14 +39,26 @@ struct State
     }
 };
 
+// Pieces put on and taken off the board by the last move, for incremental NNUE updates
+// A capture promotion removes the most pieces: the pawn twice, and the captured piece
+struct DirtyPieces
+{
+    uint8_t addedCount = 0;
+    uint8_t removedCount = 0;
+    // piece * 64 + square
+    std::array<uint16_t, 4> added{};
+    std::array<uint16_t, 4> removed{};
+};
+
 struct EvalState
 {
-    int16_t phase = 0;
-    std::array<int16_t, 2> mgScores{0 ,0};
-    std::array<int16_t, 2> egScores{0, 0};
+    // Material and piece-square scores of each side
+    std::array<Score, 2> scores{SCORE_ZERO, SCORE_ZERO};
+    DirtyPieces dirty;
 
     EvalState() = default;
 	void addPieceScores(const Piece piece, const Sq target);
+	void removePieceScores(const Piece piece, const Sq target);
 };
 
 struct Board
@@ -59,8 +73,12 @@ struct Board
     void display() const;
     void printCastling() const;
     static void parseFen(const std::string& fenStr, Board& board);
+    std::string getFen() const;
     bool isSquareAttacked(const int sq) const;
+    bool isSquareAttacked(const int sq, const Color side) const;
+    uint64_t attackersTo(const int sq, const uint64_t occupancy) const;
     bool isInCheck() const;
+    bool sideInCheck() const;
 };
 
 enum class CastlingRights : uint8_t { wk, wq, bk, bq };
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "defs.hpp"
+#include "search.hpp"
+
+#include <string>
+
+// Self-play training data: independent games on several threads, each with its own search
+// state and transposition table, streamed to a packed position file
+namespace Datagen
+{
+
+struct Params
+{
+    std::string outputFile;
+    // Stop once this many positions have been written
+    uint64_t positions = 1'000'000;
+    int threads = 1;
+    // Search limits per move; a node limit of 0 searches to 'depth'
+    int depth = Search::MAX_PLY;
+    uint64_t nodes = 5'000;
+    // Random moves played from the start position before the engine takes over
+    int randomPlies = 8;
+    // Transposition table of every thread, in MB
+    int hashMB = 8;
+    // 0 seeds from the clock
+    uint64_t seed = 0;
+};
+
+void run(const Params& params);
+
+} // namespace Datagen
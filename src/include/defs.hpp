@@ -52,3 +52,27 @@ enum class Direction : int8_t {
     SW_S = -17, // 2(SOUTH) + WEST -> 'KNIGHT ONLY'
     SW_W = -10, // SOUTH + 2(WEST) -> 'KNIGHT ONLY'
 };
+
+/* Packed middlegame and endgame score */
+// The endgame half is kept in the upper 16 bits and the middlegame half in the lower 16 bits,
+// so both halves are updated by a single add
+enum Score : int32_t { SCORE_ZERO };
+
+constexpr Score S(const int mg, const int eg)
+{
+    return (Score)(int32_t)(((uint32_t)eg << 16) + (uint32_t)mg);
+}
+// The lower half borrows from the upper one when it is negative; rounding undoes the borrow
+constexpr int egValue(const Score score)
+{
+    return (int16_t)(uint16_t)((uint32_t)(score + 0x8000) >> 16);
+}
+constexpr int mgValue(const Score score) { return (int16_t)(uint16_t)(uint32_t)score; }
+
+constexpr Score operator+(const Score a, const Score b) { return (Score)((int)a + (int)b); }
+constexpr Score operator-(const Score a, const Score b) { return (Score)((int)a - (int)b); }
+constexpr Score operator-(const Score a) { return (Score)(-(int)a); }
+constexpr Score operator*(const Score a, const int i) { return (Score)((int)a * i); }
+constexpr Score operator*(const int i, const Score a) { return a * i; }
+inline Score& operator+=(Score& a, const Score b) { return a = a + b; }
+inline Score& operator-=(Score& a, const Score b) { return a = a - b; }
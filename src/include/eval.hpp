@@ -2,6 +2,10 @@
 
 #include "board.hpp"
 #include "defs.hpp"
+#include "material.hpp"
+#include "tunable.hpp"
+
+#include <climits>
 
 namespace Eval
 {
@@ -19,28 +23,116 @@ struct KingZone
     uint64_t outerRing;
     uint64_t innerRing;
 };
+extern std::array<KingZone, 64> kingZoneMask;
+
+// Offsets of the evaluation terms in EvalTrace, one per tunable Score
+namespace Terms
+{
+enum : int {
+    PIECE_VALUE = 0,                      // [pieceType], without the king
+    PSQT = PIECE_VALUE + 5,               // [pieceType][square], white's point of view
+    PASSED_PAWN = PSQT + 6 * 64,          // [square], white's point of view
+    MOBILITY = PASSED_PAWN + 64,          // [pieceType]
+    ISOLATED_PAWN = MOBILITY + 5,
+    DOUBLED_PAWN,
+    BISHOP_PAIR,
+    KNIGHT_OUTPOST,
+    BISHOP_OUTPOST,
+    ROOK_OR_QUEEN_ON_SEVENTH,
+    ROOK_ON_OPEN_FILE,
+    TEMPO,
+    THREAT_BY_PAWN,
+    PAWN_SHIELD,                          // [distance]
+    PAWN_STORM = PAWN_SHIELD + 8,         // [distance]
+    KING_OPEN_FILE = PAWN_STORM + 8,
+    KING_SEMI_OPEN_FILE,
+    KNIGHT_PAWN_ADJUSTMENT,
+    ROOK_PAWN_ADJUSTMENT,
+    COUNT
+};
+} // namespace Terms
+
+// How many times each term was added to each side's score; the evaluation is linear in the
+// terms, apart from the king danger
+struct EvalTrace
+{
+    std::array<std::array<int16_t, 2>, Terms::COUNT> coeffs{}; // [term][color]
+    // King danger, which isn't a sum of terms
+    std::array<Score, 2> danger{SCORE_ZERO, SCORE_ZERO};
+    int16_t phase = 0;
+    std::array<uint8_t, 2> scale{Material::SCALE_NORMAL, Material::SCALE_NORMAL};
+    // False if the score came from a draw or a known ending instead of the terms
+    bool complete = false;
+};
 
 struct EvalInfo
 {
-    std::array<int16_t, 2> mgScores{0, 0};
-    std::array<int16_t, 2> egScores{0, 0};
+    std::array<Score, 2> scores{SCORE_ZERO, SCORE_ZERO};
+
+    std::array<int, 2> kingSquares{0, 0};
+    // Squares attacked by each side's pawns
+    std::array<uint64_t, 2> pawnAttacks{0ULL, 0ULL};
+    // Squares attacked by each piece type of a side, and by any piece of that side
+    std::array<std::array<uint64_t, 6>, 2> attackedBy{}; // [color][pieceType]
+    std::array<uint64_t, 2> attacked{0ULL, 0ULL};
+    // Squares a side's pieces get mobility credit for: not occupied by its own pawns or king
+    // and not attacked by enemy pawns
+    std::array<uint64_t, 2> mobilityArea{0ULL, 0ULL};
 
     std::array<KingZone, 2> kingZones;
-    std::array<uint16_t, 2> kingAttackers;
-    std::array<uint16_t, 2> kingAttackPoints;
+    // Pieces of a side attacking the enemy king zone, and the weighted number of zone squares
+    // they attack
+    std::array<uint16_t, 2> kingAttackers{0, 0};
+    std::array<uint16_t, 2> kingAttackPoints{0, 0};
+
+    // Only set when tracing
+    EvalTrace *trace = nullptr;
+};
+
+struct EvalStats
+{
+    uint64_t evals = 0;
+    // Evaluations that returned the material and piece-square score alone
+    uint64_t lazySkips = 0;
+    // Evaluations found in the evaluation cache
+    uint64_t cacheHits = 0;
 };
 
+// Tunable parameters: name, default, min, max, SPSA step
+// A lazy evaluation this far outside the (alpha, beta) window skips the full evaluation
+TUNABLE_PARAM(LAZY_EVAL_MARGIN, 500, 100, 1500, 50);
+extern thread_local EvalStats evalStats;
+
 void setMask(const int rank, const int file, uint64_t &mask);
 void initMasks();
 void genKingZones(const int sq);
-int EvalPosition(const Board &board);
+int EvalPosition(const Board &board, const int alpha = INT_MIN, const int beta = INT_MAX);
+// Full hand-crafted evaluation that also records the terms; bypasses the caches and NNUE
+int traceEval(const Board &board, EvalTrace &trace);
+// Value of one unit of a term
+Score termScore(const int term);
+// Prints the traced evaluation of a position, term by term
+void printEval(const Board &board);
+int taper(const Score score, const Material::Entry &material, const Color side);
+void initEvalInfo(const Position &pos, EvalInfo &eInfo);
+// The evaluation functions are instantiated with and without tracing, so the normal
+// evaluation pays nothing for it
+template <bool Trace> int evaluate(const Board &board, const int alpha, const int beta,
+                                   EvalTrace *trace);
+template <bool Trace> void evalThreats(const Position &pos, const Color side, EvalInfo &eInfo);
+void addKingAttacks(const Color side, const PieceTypes type, const uint64_t attacks,
+                    EvalInfo &eInfo);
+template <bool Trace>
 void evalPawn(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo);
+template <bool Trace>
 void evalKnight(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo);
+template <bool Trace>
 void evalBishop(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo);
+template <bool Trace>
 void evalRook(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo);
+template <bool Trace>
 void evalQueen(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo);
+template <bool Trace>
 void evalKing(const Position &pos, const int sq, const Color pieceColor, EvalInfo &eInfo);
-bool isDrawn(const Position &pos);
-int getPhaseScore(const Board &board);
 
 } // namespace Eval
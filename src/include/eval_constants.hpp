@@ -11,7 +11,7 @@ namespace Eval
 enum class Phase : uint8_t { MG, EG };
 
 extern const std::array<std::array<int16_t, 6>, 2> PIECE_VALUES;
-extern const std::array<std::array<int8_t, 5>, 2> PIECE_MOBILITY;
+extern const std::array<Score, 5> PIECE_MOBILITY;
 
 extern const int8_t DRAW_SCORE;
 
@@ -25,19 +25,37 @@ extern const int16_t TOTAL_PHASE;
 extern const std::array<int8_t, 6> PHASE_VALUES;
 
 // Penalties
-extern const std::array<int8_t, 2> ISOLATED_PAWN_PENALTY;
-extern const std::array<int8_t, 2> DOUBLED_PAWN_PENALTY;
+extern const Score ISOLATED_PAWN_PENALTY;
+extern const Score DOUBLED_PAWN_PENALTY;
 
 // Bonuses
-extern const std::array<int8_t, 2> BISHOP_PAIR_BONUS;
-extern const std::array<int8_t, 2> KNIGHT_OUTPOST_BONUS;
-extern const std::array<int8_t, 2> BISHOP_OUTPOUT_BONUS;
-extern const int8_t ROOK_OR_QUEEN_ON_SEVENTH_BONUS_EG;
-extern const int8_t ROOK_ON_OPEN_FILE_BONUS_MG;
-extern const int8_t TEMPO_BONUS_MG;
+extern const Score BISHOP_PAIR_BONUS;
+extern const Score KNIGHT_OUTPOST_BONUS;
+extern const Score BISHOP_OUTPOUT_BONUS;
+extern const Score ROOK_OR_QUEEN_ON_SEVENTH_BONUS;
+extern const Score ROOK_ON_OPEN_FILE_BONUS;
+extern const Score TEMPO_BONUS;
+extern const Score THREAT_BY_PAWN;
+
+// King safety
+extern const std::array<int8_t, 5> KING_ATTACK_WEIGHTS;
+extern const std::array<int8_t, 8> ATTACKER_COUNT_SCALE;
+extern const std::array<int8_t, 5> SAFE_CHECK_WEIGHTS;
+extern const int8_t WEAK_KING_SQUARE_WEIGHT;
+extern const std::array<Score, 8> PAWN_SHIELD_BONUS;
+extern const std::array<Score, 8> PAWN_STORM_PENALTY;
+extern const Score KING_OPEN_FILE_PENALTY;
+extern const Score KING_SEMI_OPEN_FILE_PENALTY;
+
+// Imbalance, per own pawn above five
+extern const Score KNIGHT_PAWN_ADJUSTMENT;
+extern const Score ROOK_PAWN_ADJUSTMENT;
 
 extern const std::array<std::array<int16_t, 64>, 6> PSQT_MG;
 extern const std::array<std::array<int16_t, 64>, 6> PSQT_EG;
-extern const std::array<std::array<int8_t, 64>, 2> PASSED_PAWN_PSQT;
+extern const std::array<Score, 64> PASSED_PAWN_PSQT;
+
+// Piece values and piece-square tables fused into one score per piece and square
+extern const std::array<std::array<Score, 64>, 12> psq; // [piece][square]
 
 } // namespace Eval
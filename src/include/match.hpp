@@ -0,0 +1,65 @@
+#pragma once
+
+#include "defs.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Engine-vs-engine matches over the UCI protocol: every game slot runs its own pair of engine
+// processes, so two binaries or two option sets of this one can be compared on any machine
+namespace Match
+{
+
+struct EngineConfig
+{
+    // Command line of the engine; empty runs this binary
+    std::string command;
+    // "setoption" pairs sent before the first game
+    std::vector<std::pair<std::string, std::string>> options;
+};
+
+struct Params
+{
+    std::array<EngineConfig, 2> engines;
+    // One position per line; every opening is played twice with colors reversed
+    std::string openingsFile;
+    // Opening of the first game pair, so consecutive matches can use different openings
+    int openingOffset = 0;
+    int games = 100;
+    int concurrency = 1;
+    // Time control in ms, or a fixed number of nodes per move if 'nodes' is set
+    int baseTime = 10'000;
+    int increment = 100;
+    uint64_t nodes = 0;
+    // Sequential probability ratio test of elo0 against elo1
+    bool sprt = false;
+    double elo0 = 0.0, elo1 = 5.0;
+    double alpha = 0.05, beta = 0.05;
+    // Print every game and the running statistics
+    bool verbose = true;
+};
+
+// From the point of view of the first engine
+struct Results
+{
+    int wins = 0;
+    int losses = 0;
+    int draws = 0;
+
+    int games() const { return wins + losses + draws; }
+};
+
+Results run(const Params& params);
+
+// Expected score of a side 'elo' points stronger
+double eloToScore(const double elo);
+// Elo difference and its 95% error margin
+double elo(const Results& results);
+double eloMargin(const Results& results);
+// Likelihood of superiority, in [0, 1]
+double los(const Results& results);
+// Log-likelihood ratio of elo1 against elo0
+double llr(const Results& results, const double elo0, const double elo1);
+
+} // namespace Match
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "board.hpp"
+#include "defs.hpp"
+
+namespace Material
+{
+
+// Endgame scores are scaled by scale / SCALE_NORMAL for the side ahead
+const uint8_t SCALE_NORMAL = 64;
+const uint8_t SCALE_DRAW = 0;
+
+struct Entry;
+// Evaluation of a known endgame, from the side to move's point of view
+using EndgameFunc = int (*)(const Board& board, const Entry& entry);
+
+// Everything about a position that only depends on its piece counts
+struct Entry
+{
+    uint64_t key = 0ULL;
+    // Game phase, from 0 (all pieces on the board) to 256 (only pawns and kings left)
+    int16_t phase = 0;
+    // Bishop pair and imbalance terms
+    std::array<Score, 2> scores{SCORE_ZERO, SCORE_ZERO};
+    // How much of its endgame advantage each side can convert
+    std::array<uint8_t, 2> scale{SCALE_NORMAL, SCALE_NORMAL};
+    // Neither side has enough material to mate
+    bool drawn = false;
+    // Specialised evaluator replacing the normal evaluation, if the ending is known
+    EndgameFunc endgame = nullptr;
+    Color strongSide = Color::WHITE;
+};
+
+void clearTable();
+Entry* probe(const Board& board);
+void computeEntry(const Board& board, Entry& entry);
+
+int evalKXK(const Board& board, const Entry& entry);
+int evalKBNK(const Board& board, const Entry& entry);
+
+} // namespace Material
@@ -30,7 +30,10 @@ bool isEnpassant(const int move);
 bool isCastling(const int move);
 std::string toString(const int move);
 int parse(const std::string& moveStr, const Board& board);
+std::string toSan(const int move, const Board& board);
+int parseSan(const std::string& moveStr, const Board& board);
 void generate(MoveList& moveList, const Board& board);
+void generateLegal(MoveList& moveList, const Board& board);
 void generatePawns(MoveList& moveList, const Board& board);
 void generateKnights(MoveList& moveList, const Board& board);
 void generateBishops(MoveList& moveList, const Board& board);
@@ -40,5 +43,6 @@ void generateKings(MoveList& moveList, const Board& board);
 void genWhiteCastling(MoveList& moveList, const Board& board);
 void genBlackCastling(MoveList& moveList, const Board& board);
 bool make(Board* main, const int move, MoveType moveFlag);
+bool see(const Board& board, const int move, const int threshold);
 
 } // namespace Move
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "board.hpp"
+#include "defs.hpp"
+
+#include <array>
+#include <string>
+
+// Optional neural network evaluation: 768 -> HIDDEN_SIZE x 2 -> 1
+// The inputs are every (color, piece type, square) combination, seen from both sides. Each side
+// keeps an accumulator with the hidden layer of its own view, which moves update incrementally.
+namespace NNUE
+{
+
+constexpr int INPUT_SIZE = 768;
+constexpr int HIDDEN_SIZE = 256;
+// Quantization of the hidden layer (QA) and the output weights (QB)
+constexpr int QA = 255;
+constexpr int QB = 64;
+// Network output to centipawns
+constexpr int EVAL_SCALE = 400;
+
+// Weights are stored as signed 16 bit integers, in this order and without a header:
+// feature weights [INPUT_SIZE][HIDDEN_SIZE], feature biases [HIDDEN_SIZE],
+// output weights [2 * HIDDEN_SIZE] (side to move first), output bias
+struct alignas(64) Network
+{
+    std::array<int16_t, INPUT_SIZE * HIDDEN_SIZE> featureWeights;
+    std::array<int16_t, HIDDEN_SIZE> featureBiases;
+    std::array<int16_t, 2 * HIDDEN_SIZE> outputWeights;
+    int16_t outputBias;
+};
+
+struct alignas(64) Accumulator
+{
+    std::array<std::array<int16_t, HIDDEN_SIZE>, 2> values; // [perspective][neuron]
+    // Position the values belong to
+    uint64_t key = 0ULL;
+    // False until the values have been brought up to date with the pieces moved
+    bool computed = false;
+    DirtyPieces dirty;
+};
+
+// Set by the UseNNUE option; only takes effect once a network is loaded
+extern bool useNNUE;
+extern bool isLoaded;
+
+inline bool enabled() { return useNNUE && isLoaded; }
+
+bool load(const std::string& path);
+// Fills the network with small random weights, to exercise the code without a network file
+void randomize();
+
+int feature(const Color perspective, const int piece, const int sq);
+void refresh(const Board& board, Accumulator& acc);
+int output(const Accumulator& acc, const Color side);
+
+// Accumulators of the search path are kept in a stack indexed by Search::ply
+void reset(const Board& board);
+void push(const Board& board);
+const Accumulator& current(const Board& board);
+int evaluate(const Board& board);
+// Compares the incrementally updated accumulator of the current ply with a full refresh
+bool verify(const Board& board);
+
+} // namespace NNUE
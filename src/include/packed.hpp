@@ -0,0 +1,88 @@
+#pragma once
+
+#include "board.hpp"
+#include "defs.hpp"
+
+#include <array>
+#include <fstream>
+#include <string>
+
+// Fixed-size binary records of scored positions, for training data and batch analysis
+// A file is a plain array of records without a header, so files can be concatenated
+namespace Packed
+{
+
+// Game result from white's point of view
+enum class Result : uint8_t { BLACK_WIN, DRAW, WHITE_WIN, UNKNOWN };
+
+struct PackedBoard
+{
+    // Occupied squares; the pieces on them follow from the lowest square up, as 4 bit piece
+    // indices, two per byte with the first one in the low nibble
+    uint64_t occupancy;
+    std::array<uint8_t, 16> pieces;
+    // Bit 0: side to move, bits 1-4: castling rights
+    uint8_t flags;
+    // Sq::noSq if there is none
+    uint8_t enpassant;
+    uint8_t halfMoves;
+    Result result;
+    // Search score from white's point of view
+    int16_t score;
+    uint16_t fullMoves;
+};
+static_assert(sizeof(PackedBoard) == 32, "Packed records must stay 32 bytes");
+
+PackedBoard pack(const Board& board, const int score = 0, const Result result = Result::UNKNOWN);
+void unpack(const PackedBoard& packed, Board& board);
+
+// Read-only memory mapping of a file of records
+struct Reader
+{
+    const PackedBoard* records = nullptr;
+    size_t count = 0;
+
+    Reader() = default;
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    ~Reader();
+    bool open(const std::string& path);
+    void close();
+    const PackedBoard& operator[](const size_t i) const { return records[i]; }
+
+  private:
+    void* view = nullptr;
+    size_t bytes = 0;
+    // Windows file and mapping handles
+    void* file = nullptr;
+    void* mapping = nullptr;
+};
+
+// Appends records to a file
+struct Writer
+{
+    bool open(const std::string& path, const bool append = false);
+    void write(const PackedBoard& record);
+    void close();
+
+  private:
+    std::ofstream out;
+};
+
+// Reads the result of a text line: "1-0", "0-1" or "1/2-1/2" anywhere, a score between
+// brackets, or the last field of "<fen> | <score> | <result>"
+bool parseResult(const std::string& line, Result& result);
+// Accepts FENs and EPD lines (the first four fields); the score is read from
+// "<fen> | <score> | <result>" lines and is 0 otherwise
+bool parseLine(const std::string& line, Board& board, int& score, Result& result);
+// Operand of an EPD operation such as 'bm' or 'id', without quotes; empty if it is missing
+std::string operation(const std::string& line, const std::string& opcode);
+// "<fen> | <score> | <result>"
+std::string formatLine(const PackedBoard& packed);
+
+// Converters between text files with one position per line and packed files; return the
+// number of positions written
+size_t textToPacked(const std::string& inPath, const std::string& outPath);
+size_t packedToText(const std::string& inPath, const std::string& outPath);
+
+} // namespace Packed
@@ -6,4 +6,6 @@
 namespace Perft {
 void driver(Board& board, const int depth);
 void test(Board& board, const int depth);
+void nnueDriver(Board& board, const int depth);
+void nnueTest(Board& board, const int depth);
 } // namespace Perft
@@ -3,8 +3,11 @@
 #include "board.hpp"
 #include "defs.hpp"
 #include "move.hpp"
+#include "tunable.hpp"
 
 #include <array>
+#include <string>
+#include <vector>
 
 namespace Search {
 
@@ -17,21 +20,129 @@ const int INF = 50'000;
 // Upper and lower bound
 const int MATE_VALUE = 49'000;
 const int MATE_SCORE = 48'000;
+const int DRAW_SCORE = 0;
 
-const int MAX_PLY = 64;
-const int FULL_DEPTH_MOVES = 4;
-const int REDUCTION_LIMIT = 3;
+const int MAX_PLY = 128;
+// Game plies whose position keys are kept for repetition detection
+const int MAX_GAME_PLY = 1024;
+// Late move pruning is only done at or below this depth
+const int LMP_DEPTH = 3;
+// Most lines a search can report
+const int MAX_MULTI_PV = 256;
 
-extern int ply, nodes;
+// Tunable parameters: name, default, min, max, SPSA step
+// Late move reductions start after this many moves, at this depth or more; they always
+// leave at least one ply, so the depth can't go below 2
+TUNABLE_PARAM(FULL_DEPTH_MOVES, 4, 1, 10, 1);
+TUNABLE_PARAM(REDUCTION_LIMIT, 3, 2, 8, 1);
+// Depth reduction of the null move search, on top of the move itself
+TUNABLE_PARAM(NULL_MOVE_REDUCTION, 2, 1, 5, 1);
+// Minimum depth and margin above beta for ProbCut, whose search is 4 plies shallower
+TUNABLE_PARAM(PROBCUT_DEPTH, 5, 5, 10, 1);
+TUNABLE_PARAM(PROBCUT_MARGIN, 200, 50, 500, 20);
+// Aspiration windows start at this depth with a half-width of ASPIRATION_DELTA plus the
+// score volatility
+TUNABLE_PARAM(ASPIRATION_DEPTH, 4, 1, 10, 1);
+TUNABLE_PARAM(ASPIRATION_DELTA, 20, 5, 100, 5);
+// Safety margin of delta pruning in the quiescence search
+TUNABLE_PARAM(DELTA_MARGIN, 200, 50, 500, 20);
+// Minimum depth for a singular extension verification search
+TUNABLE_PARAM(SINGULAR_DEPTH, 8, 4, 14, 1);
+// History score worth one ply less (or more) of reduction
+TUNABLE_PARAM(HISTORY_REDUCTION_DIVISOR, 8192, 1024, 32768, 1024);
+// The time and node limits are checked every 2^CHECK_INTERVAL_BITS nodes
+TUNABLE_PARAM(CHECK_INTERVAL_BITS, 11, 6, 16, 1);
+// Bound of every history table; updates are scaled down as an entry approaches it
+const int MAX_HISTORY = 16'384;
 
-void position(Board& board, const int depth);
+using ContHistEntry = std::array<std::array<int16_t, 64>, 12>; // [piece][target]
+
+// Per-ply context of the current search path
+struct SearchStack {
+    int staticEval = 0;
+    // Move played from this ply (0 for a null move)
+    int currentMove = 0;
+    // Move skipped by a singular extension verification search
+    int excludedMove = 0;
+    bool inCheck = false;
+    // Quiet moves that caused a beta-cutoff at this ply
+    std::array<int, 2> killers{0, 0};
+    // Continuation history of the move played from this ply
+    ContHistEntry* contHist = nullptr;
+};
+
+struct SearchStats {
+    uint64_t betaCutoffs = 0;
+    uint64_t firstMoveCutoffs = 0;
+    uint64_t lmrSearches = 0;
+    uint64_t lmrResearches = 0;
+    uint64_t lmpPrunes = 0;
+    uint64_t probCuts = 0;
+    uint64_t singularExtensions = 0;
+    uint64_t multiCuts = 0;
+    uint64_t qsearchNodes = 0;
+    uint64_t deltaPrunes = 0;
+    uint64_t aspirationResearches = 0;
+    // Nodes searched by the last two completed iterations
+    uint64_t prevIterNodes = 0;
+    uint64_t lastIterNodes = 0;
+};
+
+// Outcome of the last completed iteration of a search
+struct SearchResult {
+    int bestMove = 0;
+    int score = 0;
+    int depth = 0;
+    std::vector<int> pv;
+    // Time in ms and nodes at the end of the iteration from which on the best move stayed
+    // the same
+    int64_t bestMoveTime = 0;
+    uint64_t bestMoveNodes = 0;
+};
+
+// Root move of a search reporting several lines
+struct RootMove {
+    int move = 0;
+    // Score and PV of the line it leads, for the best moves of an iteration
+    int score = -INF;
+    std::vector<int> pv;
+    // Nodes searched below it in the current iteration
+    uint64_t nodes = 0;
+};
+
+extern thread_local int ply, rootDepth;
+extern thread_local uint64_t nodes;
+extern thread_local SearchStats stats;
+extern thread_local std::array<SearchStack, MAX_PLY + 1> searchStack;
+extern thread_local std::array<uint64_t, MAX_GAME_PLY + MAX_PLY + 1> keyHistory;
+extern thread_local int gamePly;
+// Number of best lines searched and reported
+extern thread_local int multiPV;
+
+void init();
+// Iterative deepening up to 'depth'; 'print' sends the UCI info and bestmove lines
+SearchResult position(Board& board, const int depth, const bool print = true);
+int searchMultiPV(Board& board, const int depth, const int volatility);
+// 'line' is 0 for a single line, or the 1-based MultiPV line
+void printInfo(const int score, const int depth, int64_t totalTime, const std::string& bound = "",
+               const int line = 0);
+void printStats();
 void getCPOrMateScore(const int& score);
 int negamax(Board* board, const int alpha, const int beta, const int depth);
-int quiescence(Board* board, const int alpha, const int beta);
-int scoreMoves(const Board& board, const int move);
+int quiescence(Board* board, const int alpha, const int beta, const int qsPly = 0);
+std::array<uint64_t, 6> getCheckSquares(const Board& board);
+int scoreMoves(const Board& board, const int move, const int ttMove = 0);
+int getCapturedType(const Board& board, const int move);
+int getQuietHistory(const int move);
+void updateHistories(const Board& board, const int bestMove, const int depth,
+                     const std::array<int, 64>& quietsTried, const int quietCount,
+                     const std::array<int, 64>& capturesTried, const int captureCount);
 void printMoveScores(const Move::MoveList& moveList, const Board& board);
-void sortMoves(Move::MoveList& moveList, const Board& board);
+void sortMoves(Move::MoveList& moveList, const Board& board, const int ttMove = 0);
 void clearSearchTable();
+void clearKeyHistory();
+void addGameKey(const Board& board);
+bool isRepetition(const Board& board);
 void enablePVScoring(Move::MoveList& moveList);
 
 } // namespace Search
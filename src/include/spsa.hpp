@@ -0,0 +1,35 @@
+#pragma once
+
+#include "defs.hpp"
+
+#include <string>
+#include <vector>
+
+// Simultaneous perturbation stochastic approximation of the tunable search parameters: every
+// iteration plays a few games between two randomly perturbed parameter sets and moves the
+// parameters towards the winner
+namespace Spsa
+{
+
+struct Params
+{
+    int iterations = 1000;
+    // Game pairs per iteration
+    int pairs = 1;
+    int concurrency = 1;
+    std::string openingsFile;
+    // Engine command line; empty runs this binary
+    std::string engineCommand;
+    // Short time controls, so that speed is rewarded as well; or nodes per move if set
+    int baseTime = 5'000;
+    int increment = 50;
+    uint64_t nodes = 0;
+    // Change of a parameter per game point, in multiples of its step, at the end of the run
+    double learningRate = 0.002;
+    // Parameters to tune; every registered one if empty
+    std::vector<std::string> names;
+};
+
+void run(const Params& params);
+
+} // namespace Spsa
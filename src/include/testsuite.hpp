@@ -0,0 +1,21 @@
+#pragma once
+
+#include "defs.hpp"
+
+#include <string>
+
+// Tactical test suites: EPD positions with 'bm' (best move) or 'am' (avoid move) operations,
+// scored by how soon the search settles on a right move rather than by raw speed
+namespace TestSuite
+{
+
+struct Params
+{
+    std::string file;
+    // Search time of every position, in ms
+    int moveTime = 1000;
+};
+
+void run(const Params& params);
+
+} // namespace TestSuite
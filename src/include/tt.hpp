@@ -3,12 +3,12 @@
 #include "board.hpp"
 #include "defs.hpp"
 
+#include <vector>
+
 namespace TT {
 
 extern const int NO_ENTRY;
 
-void clearTTtable();
-
 enum TTFlags { F_EXACT, F_ALPHA, F_BETA };
 
 struct TTEntry {
@@ -17,8 +17,19 @@ struct TTEntry {
     int score = 0;
     int depth = 0;
     int flag = 0;
+    int move = 0;
 };
 
-int readEntry(const Board& board, const int alpha, const int beta, const int depth);
-void writeEntry(const Board& board, const int depth, int score, const int flag);
+constexpr const int PER_MB = 1'000'000 / sizeof(TTEntry);
+using Table = std::vector<TTEntry>;
+
+void clearTTtable();
+// Makes the calling thread search its own table, e.g. for independent searches running in
+// parallel; nullptr switches back to the main table
+void useTable(Table* table);
+
+bool probeEntry(const Board& board, TTEntry& entry);
+int readEntry(const TTEntry& entry, const int alpha, const int beta, const int depth);
+void writeEntry(const Board& board, const int depth, int score, const int flag,
+                const int move = 0);
 } // namespace TT
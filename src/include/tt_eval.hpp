@@ -5,11 +5,18 @@
 
 namespace TT::Eval {
 
+// Size of the evaluation cache in MB
+extern const int DEFAULT_EVAL_HASH_MB;
+extern const int MAX_EVAL_HASH_MB;
+
+// The key is stored xor'ed with the evaluation, so an entry torn by concurrent writes fails
+// the key check instead of returning another position's evaluation
 struct EvalEntry {
-    uint64_t key = 0ULL;
+    uint64_t check = 0ULL;
     int eval = 0;
 };
 
+void resize(const int megabytes);
 void clearEvalTable();
 int readEntry(const Board& board);
 void writeEntry(const Board& board, int eval);
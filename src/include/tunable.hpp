@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Integer search parameters exposed as UCI spin options, so they can be tuned (e.g. by SPSA)
+// without rebuilding. Defining NO_TUNABLE_PARAMS turns them back into compile time constants.
+namespace Tunable
+{
+
+struct Param
+{
+    std::string name;
+    int* value;
+    int defaultValue, min, max;
+    // Perturbation of the parameter at the end of an SPSA run
+    int step;
+};
+
+std::vector<Param>& registry();
+Param* find(const std::string& name);
+
+struct Registrar
+{
+    Registrar(const char* name, int* value, const int min, const int max, const int step);
+};
+
+} // namespace Tunable
+
+#ifdef NO_TUNABLE_PARAMS
+#define TUNABLE_PARAM(name, value, min, max, step) constexpr int name = value
+#else
+#define TUNABLE_PARAM(name, value, min, max, step)                                                \
+    inline int name = value;                                                                       \
+    inline Tunable::Registrar name##Registrar(#name, &name, min, max, step)
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "defs.hpp"
+#include "eval.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Texel tuning of the evaluation terms: minimizes the squared error between the game results and
+// the winning probability of the static evaluation, over a set of labelled positions
+namespace Tuner
+{
+
+// Term weight in a traced position, white's count minus black's
+struct Coefficient
+{
+    uint16_t term;
+    int16_t count;
+};
+
+// A traced position; its evaluation only depends on the term weights from here on
+struct Entry
+{
+    // Range of the position's coefficients
+    uint32_t begin;
+    uint16_t count;
+    int16_t phase;
+    std::array<uint8_t, 2> scale;
+    // King danger, from white's point of view
+    int16_t dangerMg, dangerEg;
+    // 1 for a white win, 0.5 for a draw and 0 for a black win
+    float result;
+};
+
+struct Params
+{
+    int epochs = 1000;
+    int threads = 1;
+    double learningRate = 1.0;
+    std::string dataFile;
+    std::string outputFile = "eval_constants_tuned.cpp";
+};
+
+// Middlegame and endgame weight of every term
+using Weights = std::array<std::array<double, 2>, Eval::Terms::COUNT>; // [term][phase]
+
+Weights currentWeights();
+bool load(const std::string& path, const int threads);
+double evaluate(const Entry& entry, const Weights& weights);
+double totalError(const Weights& weights, const double k, const int threads);
+double computeK(const Weights& weights, const int threads);
+void run(const Params& params);
+void writeConstants(const std::string& path, const Weights& weights);
+
+} // namespace Tuner
@@ -1,17 +1,31 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 
 namespace UCI {
 extern bool quit;
-extern bool stop;
+extern thread_local bool stop;
+extern thread_local bool isTimeControlled;
+extern thread_local int64_t stopTime;
+extern thread_local uint64_t nodeLimit;
 void loop();
 void parse(const std::string& command);
 void parsePos(const std::string& command);
+void parseOption(const std::string& command);
+void printOptions();
+void parseTune(const std::string& command);
+void parseAnalyse(const std::string& command);
+void parseTestsuite(const std::string& command);
+void parseMatch(const std::string& command);
+void parseSpsa(const std::string& command);
+void parseDatagen(const std::string& command);
+void parseConvert(const std::string& command);
 void parseGo(const std::string& command);
 void parseParam(const std::string& cmdArgs, const std::string& cmdName, int& output);
 void checkUp();
+void waitForStop();
 void printEngineInfo();
 void printHelpInfo();
 } // namespace UCI
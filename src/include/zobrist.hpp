@@ -15,10 +15,15 @@ extern std::array<uint64_t, 8> enpassLocks;
 extern std::array<uint64_t, 16> castlingLocks;
 extern uint64_t sideLock;
 
+// Keys of the nth piece of a kind; the material key of a position is the xor of the keys of
+// every piece count up to its own
+extern std::array<std::array<uint64_t, 10>, 12> materialKeys;
+
 void init();
 uint64_t genKey(const Board& board);
 uint64_t genLock(const Board& board);
 uint64_t genPawnKey(const Board& board);
+uint64_t genMaterialKey(const Board& board);
 
 inline void togglePiece(Board& board, const int piece, const int sq)
 {
@@ -38,6 +43,12 @@ inline void toggleCastling(Board& board, const int castlingRights)
     board.state.posLock ^= castlingLocks[castlingRights];
 }
 
+// 'count' is the number of pieces of the kind without the one added or removed
+inline void toggleMaterial(Board& board, const int piece, const int count)
+{
+    board.state.materialKey ^= materialKeys[piece][count];
+}
+
 inline void toggleSide(Board& board)
 {
     board.state.posKey ^= sideKey;
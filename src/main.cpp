@@ -4,6 +4,7 @@
 #include "eval.hpp"
 #include "eval_constants.hpp"
 #include "magics.hpp"
+#include "material.hpp"
 #include "misc.hpp"
 #include "move.hpp"
 #include "perft.hpp"
@@ -27,7 +28,7 @@ void test()
     b.display();
     for (int sq = 0; sq < 64; sq++) {
         std::cout << "sq = " << strCoords[sq] << "\n";
-		Eval::genKingZones(sq);
+        Bitboard::printBits(Eval::kingZoneMask[sq].outerRing);
         std::cout << "\n------------------------------------------------------\n";
     }
 }
@@ -39,7 +40,9 @@ int main(int argc, char **argv)
     Zobrist::init();
     TT::clearTTtable();
     TT::Eval::clearEvalTable();
+    Material::clearTable();
     Eval::initMasks();
+    Search::init();
 
     if (DEBUG)
         test();
@@ -0,0 +1,564 @@
+#include "match.hpp"
+
+#include "board.hpp"
+#include "material.hpp"
+#include "misc.hpp"
+#include "move.hpp"
+#include "packed.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace Match
+{
+
+// Time allowed for the handshake and for "isready"
+const int RESPONSE_TIMEOUT = 10'000;
+// Time an engine may exceed its clock by before it loses, to absorb the pipe latency
+const int TIMEOUT_MARGIN = 100;
+
+// Handles are created one process at a time, so no child inherits another one's pipes
+std::mutex spawnMutex;
+
+// Child process with its standard input and output redirected to pipes
+class Process
+{
+  public:
+    Process() = default;
+    Process(const Process&) = delete;
+    Process& operator=(const Process&) = delete;
+    ~Process() { kill(); }
+
+    bool start(const std::string& command);
+    void write(const std::string& line);
+    // Next line of output; false on a timeout (in ms, -1 waits forever) or once the process
+    // has exited
+    bool readLine(std::string& line, const int64_t timeout);
+    void kill();
+
+  private:
+    std::string buffer;
+#ifdef _WIN32
+    HANDLE process = nullptr, in = nullptr, out = nullptr;
+#else
+    pid_t pid = -1;
+    int in = -1, out = -1;
+#endif
+};
+
+#ifdef _WIN32
+bool Process::start(const std::string& command)
+{
+    std::lock_guard<std::mutex> lock(spawnMutex);
+    SECURITY_ATTRIBUTES attributes{sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+    HANDLE childIn, childOut;
+    if (!CreatePipe(&childIn, &in, &attributes, 0))
+        return false;
+    if (!CreatePipe(&out, &childOut, &attributes, 0)) {
+        CloseHandle(childIn);
+        CloseHandle(in);
+        in = nullptr;
+        return false;
+    }
+    SetHandleInformation(in, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(out, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA startup{};
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = childIn;
+    startup.hStdOutput = childOut;
+    startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    PROCESS_INFORMATION info{};
+    std::string commandLine = command;
+    bool started = CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, TRUE, 0, nullptr,
+                                  nullptr, &startup, &info);
+    CloseHandle(childIn);
+    CloseHandle(childOut);
+    if (!started) {
+        kill();
+        return false;
+    }
+    CloseHandle(info.hThread);
+    process = info.hProcess;
+    return true;
+}
+
+void Process::write(const std::string& line)
+{
+    std::string data = line + "\n";
+    DWORD written;
+    WriteFile(in, data.data(), (DWORD)data.size(), &written, nullptr);
+}
+
+bool Process::readLine(std::string& line, const int64_t timeout)
+{
+    int64_t deadline = Time::now() + timeout;
+    size_t end;
+    while ((end = buffer.find('\n')) == std::string::npos) {
+        DWORD available = 0, read = 0;
+        if (!PeekNamedPipe(out, nullptr, 0, nullptr, &available, nullptr))
+            return false;
+        if (available == 0) {
+            if (timeout >= 0 && Time::now() >= deadline)
+                return false;
+            Sleep(1);
+            continue;
+        }
+        char chunk[4096];
+        if (!ReadFile(out, chunk, std::min<DWORD>(available, sizeof(chunk)), &read, nullptr))
+            return false;
+        buffer.append(chunk, read);
+    }
+    line = buffer.substr(0, end);
+    buffer.erase(0, end + 1);
+    if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+    return true;
+}
+
+void Process::kill()
+{
+    if (process) {
+        TerminateProcess(process, 0);
+        WaitForSingleObject(process, INFINITE);
+        CloseHandle(process);
+    }
+    if (in)
+        CloseHandle(in);
+    if (out)
+        CloseHandle(out);
+    process = in = out = nullptr;
+    buffer.clear();
+}
+#else
+bool Process::start(const std::string& command)
+{
+    std::lock_guard<std::mutex> lock(spawnMutex);
+    int toChild[2], fromChild[2];
+    if (pipe(toChild) != 0)
+        return false;
+    if (pipe(fromChild) != 0) {
+        ::close(toChild[0]);
+        ::close(toChild[1]);
+        return false;
+    }
+    // Children only keep the ends duplicated onto their standard streams
+    for (int fd : {toChild[0], toChild[1], fromChild[0], fromChild[1]})
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    std::string shellCommand = "exec " + command;
+    pid = fork();
+    if (pid == 0) {
+        dup2(toChild[0], STDIN_FILENO);
+        dup2(fromChild[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", shellCommand.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+    ::close(toChild[0]);
+    ::close(fromChild[1]);
+    in = toChild[1];
+    out = fromChild[0];
+    if (pid < 0) {
+        kill();
+        return false;
+    }
+    return true;
+}
+
+void Process::write(const std::string& line)
+{
+    std::string data = line + "\n";
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(in, data.data() + written, data.size() - written);
+        if (n <= 0)
+            return;
+        written += n;
+    }
+}
+
+bool Process::readLine(std::string& line, const int64_t timeout)
+{
+    int64_t deadline = Time::now() + timeout;
+    size_t end;
+    while ((end = buffer.find('\n')) == std::string::npos) {
+        int wait = timeout < 0 ? -1 : (int)std::max<int64_t>(deadline - Time::now(), 0);
+        pollfd request{out, POLLIN, 0};
+        if (poll(&request, 1, wait) <= 0)
+            return false;
+        char chunk[4096];
+        ssize_t n = ::read(out, chunk, sizeof(chunk));
+        if (n <= 0)
+            return false;
+        buffer.append(chunk, n);
+    }
+    line = buffer.substr(0, end);
+    buffer.erase(0, end + 1);
+    if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+    return true;
+}
+
+void Process::kill()
+{
+    if (pid > 0) {
+        ::kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+    if (in >= 0)
+        ::close(in);
+    if (out >= 0)
+        ::close(out);
+    pid = -1;
+    in = out = -1;
+    buffer.clear();
+}
+#endif
+
+// Command line that starts this binary
+std::string selfCommand()
+{
+#ifdef _WIN32
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+    return "\"" + std::string(path, length) + "\"";
+#else
+    char path[4096];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+    return length > 0 ? "'" + std::string(path, length) + "'" : "./Disaster";
+#endif
+}
+
+// UCI engine running in a child process
+class Engine
+{
+  public:
+    explicit Engine(const EngineConfig& config) : config(config) {}
+
+    // Starts (or restarts) the process and sends the options
+    bool start()
+    {
+        process.kill();
+        if (!process.start(config.command.empty() ? selfCommand() : config.command))
+            return false;
+        process.write("uci");
+        if (!waitFor("uciok", RESPONSE_TIMEOUT))
+            return false;
+        for (const auto& [name, value] : config.options)
+            process.write("setoption name " + name + " value " + value);
+        return isReady();
+    }
+
+    bool isReady()
+    {
+        process.write("isready");
+        return waitFor("readyok", RESPONSE_TIMEOUT);
+    }
+
+    void write(const std::string& line) { process.write(line); }
+
+    // Move sent after "bestmove", or an empty string if none came before the timeout
+    std::string bestMove(const int64_t timeout)
+    {
+        int64_t deadline = Time::now() + timeout;
+        std::string line;
+        auto remaining = [&]() {
+            return timeout < 0 ? -1 : std::max<int64_t>(deadline - Time::now(), 0);
+        };
+        while (process.readLine(line, remaining())) {
+            std::istringstream stream(line);
+            std::string token, move;
+            if (stream >> token >> move && token == "bestmove")
+                return move;
+        }
+        return "";
+    }
+
+    void kill() { process.kill(); }
+
+  private:
+    bool waitFor(const std::string& token, const int64_t timeout)
+    {
+        int64_t deadline = Time::now() + timeout;
+        std::string line;
+        while (process.readLine(line, std::max<int64_t>(deadline - Time::now(), 0)))
+            if (line.compare(0, token.size(), token) == 0)
+                return true;
+        return false;
+    }
+
+    const EngineConfig& config;
+    Process process;
+};
+
+std::vector<std::string> loadOpenings(const std::string& path)
+{
+    std::vector<std::string> openings;
+    if (path.empty())
+        return {Board().getFen()};
+    std::ifstream file(path);
+    std::string line;
+    Board board;
+    int score;
+    Packed::Result result;
+    while (std::getline(file, line))
+        if (Packed::parseLine(line, board, score, result))
+            openings.push_back(board.getFen());
+    return openings;
+}
+
+Packed::Result lossFor(const Color side)
+{
+    return side == Color::WHITE ? Packed::Result::BLACK_WIN : Packed::Result::WHITE_WIN;
+}
+
+// Plays a game from 'fen' between players[white] and players[black]; 'reason' tells how it
+// ended. Engines that stop responding are restarted for the next game.
+Packed::Result playGame(const Params& params, const std::array<Engine*, 2>& players,
+                        const std::string& fen, std::string& reason)
+{
+    for (int side = 0; side < 2; side++) {
+        players[side]->write("ucinewgame");
+        if (!players[side]->isReady()) {
+            reason = "no response";
+            players[side]->start();
+            return lossFor((Color)side);
+        }
+    }
+
+    Board board(fen);
+    std::vector<uint64_t> keys{board.state.posKey};
+    std::string moves;
+    std::array<int64_t, 2> clock{params.baseTime, params.baseTime};
+    while (true) {
+        Move::MoveList legal;
+        Move::generateLegal(legal, board);
+        if (legal.count == 0) {
+            reason = board.sideInCheck() ? "checkmate" : "stalemate";
+            return board.sideInCheck() ? lossFor(board.state.side) : Packed::Result::DRAW;
+        }
+        if (board.state.halfMoves >= 100) {
+            reason = "fifty moves";
+            return Packed::Result::DRAW;
+        }
+        // Positions since the last irreversible move with the same side to move
+        int repetitions = 0;
+        for (int i = (int)keys.size() - 1;
+             i >= std::max(0, (int)keys.size() - 1 - board.state.halfMoves); i -= 2)
+            repetitions += keys[i] == board.state.posKey;
+        if (repetitions >= 3) {
+            reason = "repetition";
+            return Packed::Result::DRAW;
+        }
+        if (Material::probe(board)->drawn) {
+            reason = "insufficient material";
+            return Packed::Result::DRAW;
+        }
+
+        int side = (int)board.state.side;
+        Engine& engine = *players[side];
+        engine.write("position fen " + fen + (moves.empty() ? "" : " moves" + moves));
+        if (params.nodes)
+            engine.write("go nodes " + std::to_string(params.nodes));
+        else
+            engine.write("go wtime " + std::to_string(clock[0]) + " btime " +
+                         std::to_string(clock[1]) + " winc " + std::to_string(params.increment) +
+                         " binc " + std::to_string(params.increment));
+        int64_t startTime = Time::now();
+        std::string moveStr = engine.bestMove(params.nodes ? -1 : clock[side] + TIMEOUT_MARGIN);
+        int64_t elapsed = Time::now() - startTime;
+        if (moveStr.empty()) {
+            reason = params.nodes || elapsed < clock[side] ? "disconnect" : "time forfeit";
+            engine.start();
+            return lossFor((Color)side);
+        }
+        if (!params.nodes) {
+            clock[side] -= elapsed;
+            if (clock[side] < -TIMEOUT_MARGIN) {
+                reason = "time forfeit";
+                return lossFor((Color)side);
+            }
+            clock[side] = std::max<int64_t>(clock[side], 0) + params.increment;
+        }
+
+        int move = moveStr.size() == 4 || moveStr.size() == 5 ? Move::parse(moveStr, board) : 0;
+        if (!move || !Move::make(&board, move, Move::MoveType::allMoves)) {
+            reason = "illegal move " + moveStr;
+            return lossFor((Color)side);
+        }
+        moves += " " + moveStr;
+        keys.push_back(board.state.posKey);
+    }
+}
+
+double eloToScore(const double elo) { return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0)); }
+
+double scoreToElo(const double score)
+{
+    double clamped = std::clamp(score, 1e-6, 1.0 - 1e-6);
+    return 400.0 * std::log10(clamped / (1.0 - clamped));
+}
+
+// Mean and variance of the score of a game
+void scoreStats(const Results& results, double& mean, double& variance)
+{
+    double n = results.games();
+    double w = results.wins / n, l = results.losses / n, d = results.draws / n;
+    mean = w + d / 2;
+    variance = w * std::pow(1 - mean, 2) + l * std::pow(mean, 2) + d * std::pow(0.5 - mean, 2);
+}
+
+double elo(const Results& results)
+{
+    if (results.games() == 0)
+        return 0.0;
+    double mean, variance;
+    scoreStats(results, mean, variance);
+    return scoreToElo(mean);
+}
+
+double eloMargin(const Results& results)
+{
+    if (results.games() == 0)
+        return 0.0;
+    double mean, variance;
+    scoreStats(results, mean, variance);
+    double error = 1.96 * std::sqrt(variance / results.games());
+    return (scoreToElo(mean + error) - scoreToElo(mean - error)) / 2;
+}
+
+double los(const Results& results)
+{
+    if (results.wins + results.losses == 0)
+        return 0.5;
+    return 0.5 * (1.0 + std::erf((results.wins - results.losses) /
+                                 std::sqrt(2.0 * (results.wins + results.losses))));
+}
+
+// Normal approximation of the trinomial model
+double llr(const Results& results, const double elo0, const double elo1)
+{
+    if (results.games() == 0)
+        return 0.0;
+    double mean, variance;
+    scoreStats(results, mean, variance);
+    if (variance <= 0.0)
+        return 0.0;
+    double s0 = eloToScore(elo0), s1 = eloToScore(elo1);
+    return results.games() * (s1 - s0) * (2 * mean - s0 - s1) / (2 * variance);
+}
+
+void printResults(const Params& params, const Results& results)
+{
+    std::cout << "Score " << results.wins << " - " << results.losses << " - " << results.draws
+              << " [" << std::fixed << std::setprecision(3)
+              << (results.wins + results.draws / 2.0) / std::max(results.games(), 1) << "] "
+              << results.games() << "  Elo " << std::setprecision(1) << elo(results) << " +/- "
+              << eloMargin(results) << "  LOS " << los(results) * 100 << " %";
+    if (params.sprt) {
+        std::cout << "  LLR " << std::setprecision(2) << llr(results, params.elo0, params.elo1)
+                  << " (" << std::log(params.beta / (1 - params.alpha)) << ", "
+                  << std::log((1 - params.beta) / params.alpha) << ") [" << params.elo0 << ", "
+                  << params.elo1 << "]";
+    }
+    std::cout << std::defaultfloat << "\n";
+}
+
+Results run(const Params& params)
+{
+#ifndef _WIN32
+    // Writing to an engine that died must not end the match
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    std::vector<std::string> openings = loadOpenings(params.openingsFile);
+    if (openings.empty()) {
+        std::cout << "No openings in " << params.openingsFile << "\n";
+        return Results();
+    }
+    const double lowerBound = std::log(params.beta / (1 - params.alpha));
+    const double upperBound = std::log((1 - params.beta) / params.alpha);
+
+    Results results;
+    std::mutex resultsMutex;
+    std::atomic<int> nextGame{0};
+    std::atomic<bool> finished{false};
+    auto slot = [&]() {
+        // One engine of each configuration per slot, kept between games
+        Engine first(params.engines[0]), second(params.engines[1]);
+        if (!first.start() || !second.start()) {
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            std::cout << "Could not start the engines\n";
+            finished = true;
+            return;
+        }
+        int game;
+        while (!finished && (game = nextGame++) < params.games) {
+            // The first engine plays white in even games
+            bool firstIsWhite = game % 2 == 0;
+            std::array<Engine*, 2> players = firstIsWhite ? std::array<Engine*, 2>{&first, &second}
+                                                          : std::array<Engine*, 2>{&second, &first};
+            std::string reason;
+            const std::string& fen =
+                openings[(params.openingOffset + game / 2) % openings.size()];
+            Packed::Result result = playGame(params, players, fen, reason);
+
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            if (result == Packed::Result::DRAW)
+                results.draws++;
+            else if ((result == Packed::Result::WHITE_WIN) == firstIsWhite)
+                results.wins++;
+            else
+                results.losses++;
+            if (params.verbose) {
+                static const std::array<std::string, 3> scores = {"0-1", "1/2-1/2", "1-0"};
+                std::cout << "Game " << game + 1 << " (" << (firstIsWhite ? "engine1" : "engine2")
+                          << " vs " << (firstIsWhite ? "engine2" : "engine1")
+                          << "): " << scores[(int)result] << " {" << reason << "}\n";
+                printResults(params, results);
+            }
+            if (params.sprt) {
+                double ratio = llr(results, params.elo0, params.elo1);
+                if (ratio <= lowerBound || ratio >= upperBound) {
+                    if (!finished && params.verbose)
+                        std::cout << "SPRT: " << (ratio >= upperBound ? "H1" : "H0")
+                                  << " accepted\n";
+                    finished = true;
+                }
+            }
+        }
+        first.kill();
+        second.kill();
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 0; i < std::max(params.concurrency, 1); i++)
+        pool.emplace_back(slot);
+    for (std::thread& thread : pool)
+        thread.join();
+    if (params.verbose) {
+        std::cout << "Finished match\n";
+        printResults(params, results);
+    }
+    return results;
+}
+
+} // namespace Match
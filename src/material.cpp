@@ -0,0 +1,160 @@
+#include "material.hpp"
+
+#include "bitboard.hpp"
+#include "eval_constants.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace Material
+{
+
+constexpr const int tableSize = 8192;
+// One table per thread, as entries are larger than a word and can't be written atomically
+thread_local std::array<Entry, tableSize> materialTable;
+
+// Bonus for driving the lone king to the edge and for bringing the kings together
+const int PUSH_TO_EDGE_BONUS = 20;
+const int PUSH_TOGETHER_BONUS = 10;
+// Score of a won ending, on top of the material
+const int KNOWN_WIN_BONUS = 1000;
+
+void clearTable() { materialTable.fill(Entry()); }
+
+Entry* probe(const Board& board)
+{
+    Entry* entry = &materialTable[board.state.materialKey & (tableSize - 1)];
+    if (entry->key != board.state.materialKey)
+        computeEntry(board, *entry);
+    return entry;
+}
+
+void computeEntry(const Board& board, Entry& entry)
+{
+    using namespace Eval;
+
+    entry = Entry();
+    entry.key = board.state.materialKey;
+
+    // [color][pieceType]
+    std::array<std::array<int, 5>, 2> count;
+    // Non-pawn material of each side
+    std::array<int, 2> npm{0, 0};
+    int phase = TOTAL_PHASE;
+    for (int clr = (int)Color::WHITE; clr <= (int)Color::BLACK; clr++) {
+        for (int type = (int)PieceTypes::PAWN; type <= (int)PieceTypes::QUEEN; type++) {
+            count[clr][type] = Bitboard::countBits(board.pos.pieces[clr * 6 + type]);
+            phase -= count[clr][type] * PHASE_VALUES[type];
+            if (type != (int)PieceTypes::PAWN)
+                npm[clr] += count[clr][type] * PIECE_VALUES[(int)Phase::MG][type];
+        }
+    }
+    // Promotions can put more material on the board than the starting position
+    phase = std::max(phase, 0);
+    entry.phase = (int16_t)(((phase * 256) + (TOTAL_PHASE / 2)) / TOTAL_PHASE);
+
+    for (int clr = (int)Color::WHITE; clr <= (int)Color::BLACK; clr++) {
+        const auto& side = count[clr];
+        if (side[(int)PieceTypes::BISHOP] >= 2)
+            entry.scores[clr] += BISHOP_PAIR_BONUS;
+        // Knights gain value as pawns are added, rooks lose some
+        int extraPawns = side[(int)PieceTypes::PAWN] - 5;
+        entry.scores[clr] += extraPawns * (side[(int)PieceTypes::KNIGHT] * KNIGHT_PAWN_ADJUSTMENT -
+                                           side[(int)PieceTypes::ROOK] * ROOK_PAWN_ADJUSTMENT);
+    }
+
+    int pawnCount = count[0][(int)PieceTypes::PAWN] + count[1][(int)PieceTypes::PAWN];
+    int majorCount = count[0][(int)PieceTypes::ROOK] + count[0][(int)PieceTypes::QUEEN] +
+                     count[1][(int)PieceTypes::ROOK] + count[1][(int)PieceTypes::QUEEN];
+    int minorCount = count[0][(int)PieceTypes::KNIGHT] + count[0][(int)PieceTypes::BISHOP] +
+                     count[1][(int)PieceTypes::KNIGHT] + count[1][(int)PieceTypes::BISHOP];
+
+    // Insufficient material: K vs K, KB vs K, KN vs K, KN vs KN and KB vs KB
+    bool sameMinors = count[0][(int)PieceTypes::KNIGHT] == count[1][(int)PieceTypes::KNIGHT] &&
+                      count[0][(int)PieceTypes::BISHOP] == count[1][(int)PieceTypes::BISHOP];
+    if (pawnCount + majorCount == 0 && (minorCount <= 1 || (minorCount == 2 && sameMinors))) {
+        entry.drawn = true;
+        return;
+    }
+
+    for (int clr = (int)Color::WHITE; clr <= (int)Color::BLACK; clr++) {
+        int xclr = clr ^ 1;
+        const auto& side = count[clr];
+        // Known wins against a lone king
+        if (npm[xclr] == 0 && count[xclr][(int)PieceTypes::PAWN] == 0) {
+            entry.strongSide = (Color)clr;
+            if (side[(int)PieceTypes::PAWN] == 0 && side[(int)PieceTypes::ROOK] == 0 &&
+                side[(int)PieceTypes::QUEEN] == 0 && side[(int)PieceTypes::KNIGHT] == 1 &&
+                side[(int)PieceTypes::BISHOP] == 1)
+                entry.endgame = evalKBNK;
+            else if (side[(int)PieceTypes::ROOK] + side[(int)PieceTypes::QUEEN] > 0 ||
+                     side[(int)PieceTypes::BISHOP] >= 2)
+                entry.endgame = evalKXK;
+        }
+
+        // Without pawns, a side that is at most a minor piece ahead can rarely win
+        int bishopValue = PIECE_VALUES[(int)Phase::MG][(int)PieceTypes::BISHOP];
+        int rookValue = PIECE_VALUES[(int)Phase::MG][(int)PieceTypes::ROOK];
+        if (side[(int)PieceTypes::PAWN] == 0 && npm[clr] - npm[xclr] <= bishopValue) {
+            if (npm[clr] < rookValue)
+                entry.scale[clr] = SCALE_DRAW;
+            else
+                entry.scale[clr] = npm[xclr] <= bishopValue ? SCALE_NORMAL / 16 : SCALE_NORMAL / 4;
+        }
+    }
+}
+
+int distance(const int sq1, const int sq2)
+{
+    return std::max(std::abs(ROW(sq1) - ROW(sq2)), std::abs(COL(sq1) - COL(sq2)));
+}
+
+// Distance of a square to the nearest edge of the board
+int edgeDistance(const int sq)
+{
+    return std::min({ROW(sq), 7 - ROW(sq), COL(sq), 7 - COL(sq)});
+}
+
+// Score of a won ending from the strong side's point of view, returned from the side to move's
+int knownWin(const Board& board, const Entry& entry, const int bonus)
+{
+    int strong = (int)entry.strongSide;
+    int score = egValue(board.evalState.scores[strong] - board.evalState.scores[strong ^ 1]) +
+                KNOWN_WIN_BONUS + bonus;
+    return board.state.side == entry.strongSide ? score : -score;
+}
+
+// Mating material against a lone king: drive it to the edge with the help of the king
+int evalKXK(const Board& board, const Entry& entry)
+{
+    int strongKing = Bitboard::lsbIndex(
+        board.pos.pieces[entry.strongSide == Color::WHITE ? (int)Piece::K : (int)Piece::k]);
+    int weakKing = Bitboard::lsbIndex(
+        board.pos.pieces[entry.strongSide == Color::WHITE ? (int)Piece::k : (int)Piece::K]);
+
+    int bonus = (3 - edgeDistance(weakKing)) * PUSH_TO_EDGE_BONUS +
+                (7 - distance(strongKing, weakKing)) * PUSH_TOGETHER_BONUS;
+    return knownWin(board, entry, bonus);
+}
+
+// Bishop and knight against a lone king: mate is only possible in a corner of the bishop's
+// color
+int evalKBNK(const Board& board, const Entry& entry)
+{
+    bool white = entry.strongSide == Color::WHITE;
+    int strongKing = Bitboard::lsbIndex(board.pos.pieces[white ? (int)Piece::K : (int)Piece::k]);
+    int weakKing = Bitboard::lsbIndex(board.pos.pieces[white ? (int)Piece::k : (int)Piece::K]);
+    int bishop = Bitboard::lsbIndex(board.pos.pieces[white ? (int)Piece::B : (int)Piece::b]);
+
+    // a8 and h1 are light squares, a1 and h8 are dark squares
+    int cornerDistance =
+        SQCLR(ROW(bishop), COL(bishop))
+            ? std::min(distance(weakKing, (int)Sq::a8), distance(weakKing, (int)Sq::h1))
+            : std::min(distance(weakKing, (int)Sq::a1), distance(weakKing, (int)Sq::h8));
+
+    int bonus = (7 - cornerDistance) * PUSH_TO_EDGE_BONUS +
+                (7 - distance(strongKing, weakKing)) * PUSH_TOGETHER_BONUS;
+    return knownWin(board, entry, bonus);
+}
+
+} // namespace Material
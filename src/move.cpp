@@ -1,5 +1,6 @@
 #include "move.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 #include "attack.hpp"
@@ -10,6 +11,9 @@
 namespace Move
 {
 
+// Piece values used by the static exchange evaluation
+const std::array<int, 6> SEE_VALUES = {100, 300, 300, 500, 900, 20'000};
+
 MoveList::MoveList() { list.fill(0); }
 
 void MoveList::add(const int move)
@@ -103,6 +107,73 @@ int parse(const std::string& moveStr, const Board& board)
     return searchedMove;
 }
 
+// Standard algebraic notation, e.g. "Nbd2", "exd5", "e8=Q+" or "O-O"
+std::string toSan(const int move, const Board& board)
+{
+    int source = getSource(move), target = getTarget(move), piece = getPiece(move);
+    std::string san;
+    if (isCastling(move))
+        san = COL(target) == 6 ? "O-O" : "O-O-O";
+    else if (COLORLESS(piece) == (int)PieceTypes::PAWN) {
+        if (isCapture(move))
+            san = strCoords[source].substr(0, 1) + "x";
+        san += strCoords[target];
+        if (getPromoted(move) != (int)Piece::E)
+            san += std::string("=") + pieceStr[COLORLESS(getPromoted(move))];
+    } else {
+        san = pieceStr[COLORLESS(piece)];
+        // Tell apart other pieces of the same kind that can go to the same square
+        bool ambiguous = false, sameFile = false, sameRank = false;
+        MoveList legal;
+        generateLegal(legal, board);
+        for (int i = 0; i < legal.count; i++) {
+            int other = getSource(legal.list[i]);
+            if (getPiece(legal.list[i]) != piece || getTarget(legal.list[i]) != target ||
+                other == source)
+                continue;
+            ambiguous = true;
+            sameFile |= COL(other) == COL(source);
+            sameRank |= ROW(other) == ROW(source);
+        }
+        if (ambiguous && (!sameFile || sameRank))
+            san += strCoords[source][0];
+        if (ambiguous && sameFile)
+            san += strCoords[source][1];
+        if (isCapture(move))
+            san += "x";
+        san += strCoords[target];
+    }
+
+    Board next = board;
+    make(&next, move, MoveType::allMoves);
+    if (next.sideInCheck()) {
+        MoveList replies;
+        generateLegal(replies, next);
+        san += replies.count ? "+" : "#";
+    }
+    return san;
+}
+
+// Accepts SAN with or without check and annotation marks, and coordinate notation;
+// returns 0 if no legal move matches
+int parseSan(const std::string& moveStr, const Board& board)
+{
+    auto strip = [](std::string str) {
+        str.erase(std::remove_if(str.begin(), str.end(),
+                                 [](char c) { return c == '+' || c == '#' || c == '!' || c == '?'; }),
+                  str.end());
+        std::replace(str.begin(), str.end(), '0', 'O');
+        return str;
+    };
+    std::string wanted = strip(moveStr);
+    MoveList legal;
+    generateLegal(legal, board);
+    for (int i = 0; i < legal.count; i++)
+        if (strip(toSan(legal.list[i], board)) == wanted || toString(legal.list[i]) == moveStr)
+            return legal.list[i];
+    return 0;
+}
+
 void generate(MoveList& moveList, const Board& board)
 {
     generatePawns(moveList, board);
@@ -113,6 +184,18 @@ void generate(MoveList& moveList, const Board& board)
     generateKings(moveList, board);
 }
 
+// Only the moves that don't leave the king in check; slower, as every move is made once
+void generateLegal(MoveList& moveList, const Board& board)
+{
+    MoveList pseudoLegal;
+    generate(pseudoLegal, board);
+    for (int i = 0; i < pseudoLegal.count; i++) {
+        Board copy = board;
+        if (make(&copy, pseudoLegal.list[i], MoveType::allMoves))
+            moveList.add(pseudoLegal.list[i]);
+    }
+}
+
 void generatePawns(MoveList& moveList, const Board& board)
 {
     uint64_t bitboardCopy, attackCopy;
@@ -351,7 +434,8 @@ void genWhiteCastling(MoveList& moveList, const Board& board)
             if (!getBit(board.pos.units[(int)Color::BOTH], (int)Sq::f1) &&
                 !getBit(board.pos.units[(int)Color::BOTH], (int)Sq::g1)) {
                 // Is e1 or f1 attacked by a black piece?
-                if (!board.isSquareAttacked((int)Sq::e1) && !board.isSquareAttacked((int)Sq::f1))
+                if (!board.isSquareAttacked((int)Sq::e1, Color::BLACK) &&
+                    !board.isSquareAttacked((int)Sq::f1, Color::BLACK))
                     moveList.add(
                         encode((int)Sq::e1, (int)Sq::g1, (int)Piece::K, (int)Piece::E, 0, 0, 0, 1));
             }
@@ -363,7 +447,8 @@ void genWhiteCastling(MoveList& moveList, const Board& board)
                 !getBit(board.pos.units[(int)Color::BOTH], (int)Sq::c1) &&
                 !getBit(board.pos.units[(int)Color::BOTH], (int)Sq::d1)) {
                 // Is d1 or e1 attacked by a black piece?
-                if (!board.isSquareAttacked((int)Sq::d1) && !board.isSquareAttacked((int)Sq::e1))
+                if (!board.isSquareAttacked((int)Sq::d1, Color::BLACK) &&
+                    !board.isSquareAttacked((int)Sq::e1, Color::BLACK))
                     moveList.add(
                         encode((int)Sq::e1, (int)Sq::c1, (int)Piece::K, (int)Piece::E, 0, 0, 0, 1));
             }
@@ -378,7 +463,8 @@ void genBlackCastling(MoveList& moveList, const Board& board)
         if (!getBit(board.pos.units[(int)Color::BOTH], (int)Sq::f8) &&
             !getBit(board.pos.units[(int)Color::BOTH], (int)Sq::g8)) {
             // Is e8 or f8 attacked by a white piece?
-            if (!board.isSquareAttacked((int)Sq::e8) && !board.isSquareAttacked((int)Sq::f8))
+            if (!board.isSquareAttacked((int)Sq::e8, Color::WHITE) &&
+                !board.isSquareAttacked((int)Sq::f8, Color::WHITE))
                 moveList.add(
                     encode((int)Sq::e8, (int)Sq::g8, (int)Piece::k, (int)Piece::E, 0, 0, 0, 1));
         }
@@ -390,7 +476,8 @@ void genBlackCastling(MoveList& moveList, const Board& board)
             !getBit(board.pos.units[(int)Color::BOTH], (int)Sq::c8) &&
             !getBit(board.pos.units[(int)Color::BOTH], (int)Sq::d8)) {
             // Is d8 or e8 attacked by a white piece?
-            if (!board.isSquareAttacked((int)Sq::d8) && !board.isSquareAttacked((int)Sq::e8))
+            if (!board.isSquareAttacked((int)Sq::d8, Color::WHITE) &&
+                !board.isSquareAttacked((int)Sq::e8, Color::WHITE))
                 moveList.add(
                     encode((int)Sq::e8, (int)Sq::c8, (int)Piece::k, (int)Piece::E, 0, 0, 0, 1));
         }
@@ -411,13 +498,16 @@ bool make(Board* main, const int move, MoveType moveFlag)
         bool twoSquarePush = isTwoSquarePush(move);
         bool enpassant = isEnpassant(move);
         bool castling = isCastling(move);
+        main->evalState.dirty = DirtyPieces();
 
         // Remove piece from 'source' and place on 'target'
         popBit(main->pos.pieces[piece], source);
         Zobrist::togglePiece(*main, piece, source);
+        main->evalState.removePieceScores((Piece)piece, (Sq)source);
 
         setBit(main->pos.pieces[piece], target);
         Zobrist::togglePiece(*main, piece, target);
+        main->evalState.addPieceScores((Piece)piece, (Sq)target);
 
         // If capture, remove piece of opponent bitboard
         if (capture) {
@@ -427,18 +517,32 @@ bool make(Board* main, const int move, MoveType moveFlag)
                 if (getBit(main->pos.pieces[bbPiece], target)) {
                     popBit(main->pos.pieces[bbPiece], target);
                     Zobrist::togglePiece(*main, bbPiece, target);
+                    Zobrist::toggleMaterial(*main, bbPiece,
+                                            Bitboard::countBits(main->pos.pieces[bbPiece]));
+                    main->evalState.removePieceScores((Piece)bbPiece, (Sq)target);
                     break;
                 }
             }
         }
 
+        // Pawn moves and captures are irreversible and reset the fifty-move counter
+        if (capture || piece == (int)Piece::P || piece == (int)Piece::p)
+            main->state.halfMoves = 0;
+        else
+            main->state.halfMoves++;
+
         // Promotion move
         if (promoted != (int)Piece::E) {
             popBit(main->pos.pieces[piece], target);
             Zobrist::togglePiece(*main, piece, target);
+            Zobrist::toggleMaterial(*main, piece, Bitboard::countBits(main->pos.pieces[piece]));
+            main->evalState.removePieceScores((Piece)piece, (Sq)target);
 
+            Zobrist::toggleMaterial(*main, promoted,
+                                    Bitboard::countBits(main->pos.pieces[promoted]));
             setBit(main->pos.pieces[promoted], target);
             Zobrist::togglePiece(*main, promoted, target);
+            main->evalState.addPieceScores((Piece)promoted, (Sq)target);
         }
 
         // Enpassant capture
@@ -447,9 +551,17 @@ bool make(Board* main, const int move, MoveType moveFlag)
             if (main->state.side == Color::WHITE) {
                 popBit(main->pos.pieces[(int)Piece::p], target + (int)Direction::NORTH);
                 Zobrist::togglePiece(*main, (int)Piece::p, target + (int)Direction::NORTH);
+                Zobrist::toggleMaterial(*main, (int)Piece::p,
+                                        Bitboard::countBits(main->pos.pieces[(int)Piece::p]));
+                main->evalState.removePieceScores(Piece::p,
+                                                  (Sq)(target + (int)Direction::NORTH));
             } else {
                 popBit(main->pos.pieces[(int)Piece::P], target + (int)Direction::SOUTH);
                 Zobrist::togglePiece(*main, (int)Piece::P, target + (int)Direction::SOUTH);
+                Zobrist::toggleMaterial(*main, (int)Piece::P,
+                                        Bitboard::countBits(main->pos.pieces[(int)Piece::P]));
+                main->evalState.removePieceScores(Piece::P,
+                                                  (Sq)(target + (int)Direction::SOUTH));
             }
         }
         if (main->state.enpassant != Sq::noSq)
@@ -473,30 +585,38 @@ bool make(Board* main, const int move, MoveType moveFlag)
             case (int)Sq::g1:
                 popBit(main->pos.pieces[(int)Piece::R], (int)Sq::h1);
                 Zobrist::togglePiece(*main, (int)Piece::R, (int)Sq::h1);
+                main->evalState.removePieceScores(Piece::R, Sq::h1);
 
                 setBit(main->pos.pieces[(int)Piece::R], (int)Sq::f1);
                 Zobrist::togglePiece(*main, (int)Piece::R, (int)Sq::f1);
+                main->evalState.addPieceScores(Piece::R, Sq::f1);
                 break;
             case (int)Sq::c1:
                 popBit(main->pos.pieces[(int)Piece::R], (int)Sq::a1);
                 Zobrist::togglePiece(*main, (int)Piece::R, (int)Sq::a1);
+                main->evalState.removePieceScores(Piece::R, Sq::a1);
 
                 setBit(main->pos.pieces[(int)Piece::R], (int)Sq::d1);
                 Zobrist::togglePiece(*main, (int)Piece::R, (int)Sq::d1);
+                main->evalState.addPieceScores(Piece::R, Sq::d1);
                 break;
             case (int)Sq::g8:
                 popBit(main->pos.pieces[(int)Piece::r], (int)Sq::h8);
                 Zobrist::togglePiece(*main, (int)Piece::r, (int)Sq::h8);
+                main->evalState.removePieceScores(Piece::r, Sq::h8);
 
                 setBit(main->pos.pieces[(int)Piece::r], (int)Sq::f8);
                 Zobrist::togglePiece(*main, (int)Piece::r, (int)Sq::f8);
+                main->evalState.addPieceScores(Piece::r, Sq::f8);
                 break;
             case (int)Sq::c8:
                 popBit(main->pos.pieces[(int)Piece::r], (int)Sq::a8);
                 Zobrist::togglePiece(*main, (int)Piece::r, (int)Sq::a8);
+                main->evalState.removePieceScores(Piece::r, Sq::a8);
 
                 setBit(main->pos.pieces[(int)Piece::r], (int)Sq::d8);
                 Zobrist::togglePiece(*main, (int)Piece::r, (int)Sq::d8);
+                main->evalState.addPieceScores(Piece::r, Sq::d8);
                 break;
             }
         }
@@ -520,7 +640,9 @@ bool make(Board* main, const int move, MoveType moveFlag)
             *main = clone;
             return false;
         } else {
-            main->state.fullMoves++;
+            // Full moves are counted after each black move
+            if (main->state.side == Color::WHITE)
+                main->state.fullMoves++;
             // Move is legal and was made, return true
             return true;
         }
@@ -533,4 +655,73 @@ bool make(Board* main, const int move, MoveType moveFlag)
     }
 }
 
-} // namespace Move
\ No newline at end of file
+// Static exchange evaluation
+// Does the sequence of captures on the target square gain at least 'threshold' for the
+// side to move?
+bool see(const Board& board, const int move, const int threshold)
+{
+    // Castling can't lose material
+    if (isCastling(move))
+        return threshold <= 0;
+
+    int source = getSource(move), target = getTarget(move);
+    int captured = isEnpassant(move) ? (int)Piece::P : board.pos.getPieceOnSquare(target);
+    int swap = (captured == (int)Piece::E ? 0 : SEE_VALUES[captured % 6]) - threshold;
+    if (swap < 0)
+        return false;
+
+    swap = SEE_VALUES[getPiece(move) % 6] - swap;
+    if (swap <= 0)
+        return true;
+
+    uint64_t occupancy = board.pos.units[(int)Color::BOTH];
+    popBit(occupancy, source);
+    setBit(occupancy, target);
+    if (isEnpassant(move))
+        popBit(occupancy, target + (board.state.side == Color::WHITE ? (int)Direction::NORTH
+                                                                      : (int)Direction::SOUTH));
+
+    uint64_t bishopsQueens = board.pos.pieces[(int)Piece::B] | board.pos.pieces[(int)Piece::b] |
+                             board.pos.pieces[(int)Piece::Q] | board.pos.pieces[(int)Piece::q];
+    uint64_t rooksQueens = board.pos.pieces[(int)Piece::R] | board.pos.pieces[(int)Piece::r] |
+                           board.pos.pieces[(int)Piece::Q] | board.pos.pieces[(int)Piece::q];
+    uint64_t attackers = board.attackersTo(target, occupancy);
+    int side = (int)board.state.side;
+    bool result = true;
+
+    while (true) {
+        side ^= 1;
+        // Captured pieces no longer attack
+        attackers &= occupancy;
+        uint64_t sideAttackers = attackers & board.pos.units[side];
+        if (!sideAttackers)
+            break;
+        result = !result;
+
+        // Recapture with the least valuable attacker
+        int pieceType = (int)PieceTypes::PAWN;
+        uint64_t leastValuable = 0;
+        for (; pieceType <= (int)PieceTypes::KING; pieceType++) {
+            if ((leastValuable = sideAttackers & board.pos.pieces[pieceType + side * 6]))
+                break;
+        }
+
+        // The king can only recapture if the square isn't defended anymore
+        if (pieceType == (int)PieceTypes::KING)
+            return (attackers & board.pos.units[side ^ 1]) ? !result : result;
+
+        if ((swap = SEE_VALUES[pieceType] - swap) < (int)result)
+            break;
+
+        popBit(occupancy, Bitboard::lsbIndex(leastValuable));
+        // Add the sliders behind the recapturing piece
+        if (pieceType == (int)PieceTypes::PAWN || pieceType == (int)PieceTypes::BISHOP ||
+            pieceType == (int)PieceTypes::QUEEN)
+            attackers |= Magics::getBishopAttack(target, occupancy) & bishopsQueens;
+        if (pieceType == (int)PieceTypes::ROOK || pieceType == (int)PieceTypes::QUEEN)
+            attackers |= Magics::getRookAttack(target, occupancy) & rooksQueens;
+    }
+    return result;
+}
+
+} // namespace Move
@@ -0,0 +1,259 @@
+#include "nnue.hpp"
+
+#include "bitboard.hpp"
+#include "search.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace NNUE
+{
+
+bool useNNUE = false;
+bool isLoaded = false;
+
+Network network;
+thread_local std::array<Accumulator, Search::MAX_PLY + 1> accumulators; // [ply]
+
+// Vector kernels on int16 lanes: AVX2, SSE2 or plain scalar code
+#if defined(__AVX2__)
+using Vec = __m256i;
+constexpr int LANES = 16;
+inline Vec vecLoad(const int16_t* p) { return _mm256_load_si256((const __m256i*)p); }
+inline void vecStore(int16_t* p, const Vec v) { _mm256_store_si256((__m256i*)p, v); }
+inline Vec vecAdd(const Vec a, const Vec b) { return _mm256_add_epi16(a, b); }
+inline Vec vecSub(const Vec a, const Vec b) { return _mm256_sub_epi16(a, b); }
+inline Vec vecZero() { return _mm256_setzero_si256(); }
+inline Vec vecSet(const int16_t x) { return _mm256_set1_epi16(x); }
+inline Vec vecClamp(const Vec v, const Vec lo, const Vec hi)
+{
+    return _mm256_min_epi16(_mm256_max_epi16(v, lo), hi);
+}
+// Multiplies the int16 lanes and adds adjacent pairs of products into int32 lanes
+inline Vec vecMulAdd(const Vec sum, const Vec a, const Vec b)
+{
+    return _mm256_add_epi32(sum, _mm256_madd_epi16(a, b));
+}
+inline int vecSum32(const Vec v)
+{
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+using Vec = __m128i;
+constexpr int LANES = 8;
+inline Vec vecLoad(const int16_t* p) { return _mm_load_si128((const __m128i*)p); }
+inline void vecStore(int16_t* p, const Vec v) { _mm_store_si128((__m128i*)p, v); }
+inline Vec vecAdd(const Vec a, const Vec b) { return _mm_add_epi16(a, b); }
+inline Vec vecSub(const Vec a, const Vec b) { return _mm_sub_epi16(a, b); }
+inline Vec vecZero() { return _mm_setzero_si128(); }
+inline Vec vecSet(const int16_t x) { return _mm_set1_epi16(x); }
+inline Vec vecClamp(const Vec v, const Vec lo, const Vec hi)
+{
+    return _mm_min_epi16(_mm_max_epi16(v, lo), hi);
+}
+inline Vec vecMulAdd(const Vec sum, const Vec a, const Vec b)
+{
+    return _mm_add_epi32(sum, _mm_madd_epi16(a, b));
+}
+inline int vecSum32(const Vec v)
+{
+    __m128i sum = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+#else
+using Vec = int32_t;
+constexpr int LANES = 1;
+inline Vec vecLoad(const int16_t* p) { return *p; }
+inline void vecStore(int16_t* p, const Vec v) { *p = (int16_t)v; }
+inline Vec vecAdd(const Vec a, const Vec b) { return (int16_t)(a + b); }
+inline Vec vecSub(const Vec a, const Vec b) { return (int16_t)(a - b); }
+inline Vec vecZero() { return 0; }
+inline Vec vecSet(const int16_t x) { return x; }
+inline Vec vecClamp(const Vec v, const Vec lo, const Vec hi) { return std::clamp(v, lo, hi); }
+inline Vec vecMulAdd(const Vec sum, const Vec a, const Vec b) { return sum + a * b; }
+inline int vecSum32(const Vec v) { return v; }
+#endif
+
+static_assert(HIDDEN_SIZE % LANES == 0, "Hidden layer must be a multiple of the vector width");
+
+bool load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "info string Could not open NNUE file " << path << "\n";
+        return false;
+    }
+    file.read((char*)network.featureWeights.data(), sizeof(network.featureWeights));
+    file.read((char*)network.featureBiases.data(), sizeof(network.featureBiases));
+    file.read((char*)network.outputWeights.data(), sizeof(network.outputWeights));
+    file.read((char*)&network.outputBias, sizeof(network.outputBias));
+    if (!file) {
+        std::cout << "info string NNUE file " << path << " is too small for a " << INPUT_SIZE
+                  << "->" << HIDDEN_SIZE << "x2->1 network\n";
+        isLoaded = false;
+        return false;
+    }
+    isLoaded = true;
+    // Accumulators computed with the previous weights are no longer valid
+    for (Accumulator& acc : accumulators)
+        acc.key = 0ULL;
+    std::cout << "info string Loaded NNUE file " << path << "\n";
+    return true;
+}
+
+void randomize()
+{
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> featureDist(-32, 32), outputDist(-64, 64);
+    for (int16_t& w : network.featureWeights)
+        w = (int16_t)featureDist(rng);
+    for (int16_t& b : network.featureBiases)
+        b = (int16_t)featureDist(rng);
+    for (int16_t& w : network.outputWeights)
+        w = (int16_t)outputDist(rng);
+    network.outputBias = 0;
+    isLoaded = false;
+    for (Accumulator& acc : accumulators)
+        acc.key = 0ULL;
+}
+
+// Own pieces first, then the opponent's; squares from a1, mirrored vertically for black
+int feature(const Color perspective, const int piece, const int sq)
+{
+    int color = piece / 6, type = piece % 6;
+    int relativeSq = perspective == Color::WHITE ? FLIP(sq) : sq;
+    return ((color == (int)perspective ? 0 : 6) + type) * 64 + relativeSq;
+}
+
+void refresh(const Board& board, Accumulator& acc)
+{
+    for (int perspective = (int)Color::WHITE; perspective <= (int)Color::BLACK; perspective++) {
+        int16_t* values = acc.values[perspective].data();
+        std::copy(network.featureBiases.begin(), network.featureBiases.end(), values);
+        for (int piece = (int)Piece::P; piece <= (int)Piece::k; piece++) {
+            uint64_t bitboardCopy = board.pos.pieces[piece];
+            while (bitboardCopy) {
+                int sq = Bitboard::lsbIndex(bitboardCopy);
+                const int16_t* weights =
+                    &network.featureWeights[feature((Color)perspective, piece, sq) * HIDDEN_SIZE];
+                for (int i = 0; i < HIDDEN_SIZE; i += LANES)
+                    vecStore(&values[i], vecAdd(vecLoad(&values[i]), vecLoad(&weights[i])));
+                popBit(bitboardCopy, sq);
+            }
+        }
+    }
+    acc.key = board.state.posKey;
+    acc.computed = true;
+}
+
+// Computes 'acc' from the accumulator of the previous ply and the pieces moved in between
+void update(const Accumulator& prev, Accumulator& acc)
+{
+    const DirtyPieces& dirty = acc.dirty;
+    for (int perspective = (int)Color::WHITE; perspective <= (int)Color::BLACK; perspective++) {
+        std::array<const int16_t*, 4> added, removed;
+        for (int i = 0; i < dirty.addedCount; i++)
+            added[i] = &network.featureWeights[feature((Color)perspective, dirty.added[i] / 64,
+                                                       dirty.added[i] % 64) *
+                                               HIDDEN_SIZE];
+        for (int i = 0; i < dirty.removedCount; i++)
+            removed[i] = &network.featureWeights[feature((Color)perspective, dirty.removed[i] / 64,
+                                                         dirty.removed[i] % 64) *
+                                                 HIDDEN_SIZE];
+
+        const int16_t* in = prev.values[perspective].data();
+        int16_t* out = acc.values[perspective].data();
+        for (int i = 0; i < HIDDEN_SIZE; i += LANES) {
+            Vec v = vecLoad(&in[i]);
+            for (int j = 0; j < dirty.addedCount; j++)
+                v = vecAdd(v, vecLoad(&added[j][i]));
+            for (int j = 0; j < dirty.removedCount; j++)
+                v = vecSub(v, vecLoad(&removed[j][i]));
+            vecStore(&out[i], v);
+        }
+    }
+    acc.computed = true;
+}
+
+// Clipped ReLU on both accumulators, then the output layer
+int output(const Accumulator& acc, const Color side)
+{
+    const Vec zero = vecZero(), qa = vecSet(QA);
+    Vec sum = vecZero();
+    const std::array<const int16_t*, 2> inputs{acc.values[(int)side].data(),
+                                               acc.values[(int)side ^ 1].data()};
+    for (int half = 0; half < 2; half++) {
+        const int16_t* weights = &network.outputWeights[half * HIDDEN_SIZE];
+        for (int i = 0; i < HIDDEN_SIZE; i += LANES)
+            sum = vecMulAdd(sum, vecClamp(vecLoad(&inputs[half][i]), zero, qa),
+                            vecLoad(&weights[i]));
+    }
+    int64_t result = (int64_t)vecSum32(sum) + network.outputBias;
+    return (int)(result * EVAL_SCALE / (QA * QB));
+}
+
+void reset(const Board& board) { refresh(board, accumulators[0]); }
+
+void push(const Board& board)
+{
+    if (Search::ply > Search::MAX_PLY)
+        return;
+    Accumulator& acc = accumulators[Search::ply];
+    acc.key = board.state.posKey;
+    acc.computed = false;
+    acc.dirty = board.evalState.dirty;
+}
+
+const Accumulator& current(const Board& board)
+{
+    // Boards evaluated outside of the search path are refreshed from scratch
+    thread_local Accumulator scratch;
+    if (Search::ply > Search::MAX_PLY) {
+        refresh(board, scratch);
+        return scratch;
+    }
+    Accumulator& acc = accumulators[Search::ply];
+    if (acc.key != board.state.posKey) {
+        refresh(board, acc);
+        return acc;
+    }
+    if (acc.computed)
+        return acc;
+
+    // Walk back to the last computed ply and replay the moves made since then
+    int first = Search::ply;
+    while (first > 0 && !accumulators[first - 1].computed)
+        first--;
+    if (first == 0) {
+        refresh(board, acc);
+        return acc;
+    }
+    for (int p = first; p <= Search::ply; p++)
+        update(accumulators[p - 1], accumulators[p]);
+    return acc;
+}
+
+int evaluate(const Board& board) { return output(current(board), board.state.side); }
+
+bool verify(const Board& board)
+{
+    thread_local Accumulator expected;
+    const Accumulator& acc = current(board);
+    refresh(board, expected);
+    return acc.values == expected.values;
+}
+
+} // namespace NNUE
@@ -0,0 +1,270 @@
+#include "packed.hpp"
+
+#include "bitboard.hpp"
+#include "zobrist.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Packed
+{
+
+PackedBoard pack(const Board& board, const int score, const Result result)
+{
+    PackedBoard packed{};
+    packed.occupancy = board.pos.units[(int)Color::BOTH];
+    int i = 0;
+    uint64_t occupancy = packed.occupancy;
+    while (occupancy) {
+        int sq = Bitboard::lsbIndex(occupancy);
+        packed.pieces[i / 2] |= (uint8_t)(board.pos.getPieceOnSquare(sq) << (4 * (i % 2)));
+        i++;
+        popBit(occupancy, sq);
+    }
+    packed.flags = (uint8_t)((int)board.state.side | (board.state.castling << 1));
+    packed.enpassant = (uint8_t)board.state.enpassant;
+    packed.halfMoves = (uint8_t)std::min(board.state.halfMoves, 255);
+    packed.result = result;
+    packed.score = (int16_t)std::clamp(score, -32'000, 32'000);
+    packed.fullMoves = (uint16_t)std::clamp(board.state.fullMoves, 0, 65'535);
+    return packed;
+}
+
+void unpack(const PackedBoard& packed, Board& board)
+{
+    board.pos = Position();
+    board.state = State();
+    board.evalState = EvalState();
+    int i = 0;
+    uint64_t occupancy = packed.occupancy;
+    while (occupancy) {
+        int sq = Bitboard::lsbIndex(occupancy);
+        int piece = (packed.pieces[i / 2] >> (4 * (i % 2))) & 0xF;
+        setBit(board.pos.pieces[piece], sq);
+        board.evalState.addPieceScores((Piece)piece, (Sq)sq);
+        i++;
+        popBit(occupancy, sq);
+    }
+    board.pos.updateUnits();
+    // Set up from scratch rather than by a move
+    board.evalState.dirty = DirtyPieces();
+
+    board.state.side = (Color)(packed.flags & 1);
+    board.state.xside = (Color)((int)board.state.side ^ 1);
+    board.state.castling = (packed.flags >> 1) & 0xF;
+    board.state.enpassant = (Sq)packed.enpassant;
+    board.state.halfMoves = packed.halfMoves;
+    board.state.fullMoves = packed.fullMoves;
+    board.state.posKey = Zobrist::genKey(board);
+    board.state.posLock = Zobrist::genLock(board);
+    board.state.materialKey = Zobrist::genMaterialKey(board);
+}
+
+Reader::~Reader() { close(); }
+
+bool Reader::open(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    bytes = (size_t)size.QuadPart;
+    if (bytes > 0) {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    fstat(fd, &info);
+    bytes = (size_t)info.st_size;
+    if (bytes > 0) {
+        view = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED)
+            view = nullptr;
+        else
+            madvise(view, bytes, MADV_SEQUENTIAL);
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+#endif
+    if (bytes > 0 && view == nullptr) {
+        close();
+        return false;
+    }
+    records = (const PackedBoard*)view;
+    count = bytes / sizeof(PackedBoard);
+    return true;
+}
+
+void Reader::close()
+{
+#ifdef _WIN32
+    if (view)
+        UnmapViewOfFile(view);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+#else
+    if (view)
+        munmap(view, bytes);
+#endif
+    view = mapping = file = nullptr;
+    records = nullptr;
+    bytes = count = 0;
+}
+
+bool Writer::open(const std::string& path, const bool append)
+{
+    out.open(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+    return (bool)out;
+}
+
+void Writer::write(const PackedBoard& record) { out.write((const char*)&record, sizeof(record)); }
+
+void Writer::close() { out.close(); }
+
+Result toResult(const float result)
+{
+    return result > 0.75f ? Result::WHITE_WIN : result < 0.25f ? Result::BLACK_WIN : Result::DRAW;
+}
+
+bool parseResult(const std::string& line, Result& result)
+{
+    size_t ind;
+    if (line.find("1/2-1/2") != std::string::npos)
+        result = Result::DRAW;
+    else if (line.find("1-0") != std::string::npos)
+        result = Result::WHITE_WIN;
+    else if (line.find("0-1") != std::string::npos)
+        result = Result::BLACK_WIN;
+    else if ((ind = line.find('[')) != std::string::npos)
+        result = toResult(std::strtof(line.c_str() + ind + 1, nullptr));
+    else if ((ind = line.rfind('|')) != std::string::npos)
+        result = toResult(std::strtof(line.c_str() + ind + 1, nullptr));
+    else
+        return false;
+    return true;
+}
+
+bool parseLine(const std::string& line, Board& board, int& score, Result& result)
+{
+    if (!parseResult(line, result))
+        result = Result::UNKNOWN;
+    score = 0;
+    size_t bar = line.find('|');
+    if (bar != std::string::npos)
+        score = atoi(line.c_str() + bar + 1);
+
+    // Piece placement, side, castling and en passant, then the move counters if present
+    std::istringstream stream(line.substr(0, bar));
+    std::string field, fen;
+    int fields = 0;
+    while (fields < 6 && stream >> field) {
+        if (fields >= 4 && !std::isdigit((unsigned char)field[0]))
+            break;
+        fen += (fields ? " " : "") + field;
+        fields++;
+    }
+    if (fields < 4)
+        return false;
+    if (fields == 4)
+        fen += " 0 1";
+    else if (fields == 5)
+        fen += " 1";
+    board = Board(fen);
+    return true;
+}
+
+std::string operation(const std::string& line, const std::string& opcode)
+{
+    // Operations follow the four position fields and end with semicolons
+    std::istringstream stream(line);
+    std::string field, operations;
+    for (int i = 0; i < 4; i++)
+        stream >> field;
+    std::getline(stream, operations);
+    std::istringstream opStream(operations);
+    std::string op;
+    while (std::getline(opStream, op, ';')) {
+        std::istringstream tokens(op);
+        std::string code, operand;
+        if (!(tokens >> code) || code != opcode)
+            continue;
+        std::getline(tokens >> std::ws, operand);
+        while (!operand.empty() && std::isspace((unsigned char)operand.back()))
+            operand.pop_back();
+        if (operand.size() >= 2 && operand.front() == '"' && operand.back() == '"')
+            operand = operand.substr(1, operand.size() - 2);
+        return operand;
+    }
+    return "";
+}
+
+std::string formatLine(const PackedBoard& packed)
+{
+    static const std::array<std::string, 4> results = {"0.0", "0.5", "1.0", "-"};
+    Board board;
+    unpack(packed, board);
+    return board.getFen() + " | " + std::to_string(packed.score) + " | " +
+           results[(int)packed.result];
+}
+
+size_t textToPacked(const std::string& inPath, const std::string& outPath)
+{
+    std::ifstream in(inPath);
+    Writer writer;
+    if (!in || !writer.open(outPath)) {
+        std::cout << "Could not open " << (!in ? inPath : outPath) << "\n";
+        return 0;
+    }
+    size_t written = 0;
+    std::string line;
+    Board board;
+    int score;
+    Result result;
+    while (std::getline(in, line)) {
+        if (!parseLine(line, board, score, result))
+            continue;
+        writer.write(pack(board, score, result));
+        written++;
+    }
+    return written;
+}
+
+size_t packedToText(const std::string& inPath, const std::string& outPath)
+{
+    Reader reader;
+    std::ofstream out(outPath);
+    if (!reader.open(inPath) || !out) {
+        std::cout << "Could not open " << (!out ? outPath : inPath) << "\n";
+        return 0;
+    }
+    for (size_t i = 0; i < reader.count; i++)
+        out << formatLine(reader[i]) << "\n";
+    return reader.count;
+}
+
+} // namespace Packed
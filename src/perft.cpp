@@ -3,11 +3,16 @@
 #include "bitboard.hpp"
 #include "misc.hpp"
 #include "move.hpp"
+#include "nnue.hpp"
+#include "search.hpp"
 #include "zobrist.hpp"
 
+#include <algorithm>
+
 namespace Perft {
 
 uint64_t totalNodes;
+uint64_t nnueMismatches;
 
 void driver(Board& board, int depth) {
     if (depth == 0) {
@@ -76,4 +81,47 @@ void test(Board& board, const int depth) {
     std::cout << "     Nodes: " << totalNodes << "\n";
     std::cout << "      Time: " << Time::end() << "\n";
 }
+
+// Walks the perft tree like the search does, pushing an accumulator for every move, and checks
+// the incrementally updated accumulators against full refreshes at the leaves. Interior nodes are
+// only brought up to date lazily, by the first leaf below them.
+void nnueDriver(Board& board, int depth) {
+    if (depth == 0) {
+        totalNodes++;
+        if (!NNUE::verify(board))
+            nnueMismatches++;
+        return;
+    }
+    Move::MoveList moveList;
+    Move::generate(moveList, board);
+    Board clone;
+    for (int i = 0; i < moveList.count; i++) {
+        clone = board;
+        if (!Move::make(&board, moveList.list[i], Move::MoveType::allMoves))
+            continue;
+        Search::ply++;
+        NNUE::push(board);
+        nnueDriver(board, depth - 1);
+        Search::ply--;
+        board = clone;
+    }
+}
+
+void nnueTest(Board& board, const int depth) {
+    std::cout << "\n--------------- NNUE Consistency Test (" << depth << ") ---------------\n";
+    if (!NNUE::isLoaded) {
+        std::cout << "     No network loaded, using random weights\n";
+        NNUE::randomize();
+    }
+    totalNodes = 0L;
+    nnueMismatches = 0L;
+    Time::start();
+    Search::ply = 0;
+    NNUE::reset(board);
+    nnueDriver(board, std::min(depth, Search::MAX_PLY));
+    std::cout << "\n     Depth: " << depth << "\n";
+    std::cout << "    Leaves: " << totalNodes << "\n";
+    std::cout << "Mismatches: " << nnueMismatches << "\n";
+    std::cout << "      Time: " << Time::end() << "\n";
+}
 } // namespace Perft
@@ -1,91 +1,347 @@
 #include "search.hpp"
 
+#include "attack.hpp"
 #include "bitboard.hpp"
 #include "eval.hpp"
+#include "eval_constants.hpp"
+#include "magics.hpp"
 #include "misc.hpp"
+#include "nnue.hpp"
 #include "tt.hpp"
 #include "uci.hpp"
 #include "zobrist.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace Search
 {
-// clang-format off
-// [attacker][victim]
-const std::array<std::array<int, 6>, 6> mvvLva =
+// Capture ordering: the victim's value, plus LVA_STEP for every piece type the attacker is
+// cheaper than a king
+TUNABLE_PARAM(MVV_PAWN, 100, 0, 1000, 20);
+TUNABLE_PARAM(MVV_KNIGHT, 200, 0, 1000, 20);
+TUNABLE_PARAM(MVV_BISHOP, 300, 0, 1000, 20);
+TUNABLE_PARAM(MVV_ROOK, 400, 0, 1000, 20);
+TUNABLE_PARAM(MVV_QUEEN, 500, 0, 1000, 20);
+TUNABLE_PARAM(LVA_STEP, 1, 0, 20, 1);
+
+int mvvLva(const int attacker, const int victim)
 {
-	{{105, 205, 305, 405, 505, 605},
-	{104, 204, 304, 404, 504, 604},
-	{103, 203, 303, 403, 503, 603},
-	{102, 202, 302, 402, 502, 602},
-	{101, 201, 301, 401, 501, 601},
-	{100, 200, 300, 400, 500, 600}}
-};
-// clang-format on
-int ply;
+    const std::array<int, 6> victimValues = {MVV_PAWN, MVV_KNIGHT, MVV_BISHOP,
+                                             MVV_ROOK, MVV_QUEEN,  600};
+    return victimValues[victim] + LVA_STEP * (5 - attacker);
+}
+
+// Everything a search writes to is thread local, so independent searches can run on
+// several threads at once; the tables filled by init() are shared
+thread_local int ply;
+// Depth of the current iterative deepening iteration
+thread_local int rootDepth;
 // Total positions searched counter
-int nodes;
+thread_local uint64_t nodes;
+thread_local SearchStats stats;
+
+// Late move reductions, indexed by remaining depth and number of moves searched
+std::array<std::array<int, 256>, MAX_PLY> reductions; // [depth][moveNumber]
+// Quiet moves searched before the rest are pruned at shallow depths
+std::array<std::array<int, LMP_DEPTH + 1>, 2> lateMoveCount; // [improving][depth]
+// Context of the positions on the current search path
+thread_local std::array<SearchStack, MAX_PLY + 1> searchStack; // [ply]
+// Position keys of the game played so far, followed by the ones of the current search path
+thread_local std::array<uint64_t, MAX_GAME_PLY + MAX_PLY + 1> keyHistory; // [gamePly + ply]
+// Number of game positions before the root inside keyHistory
+thread_local int gamePly;
 
-// Quiet moves that caused a beta-cutoff
-std::array<std::array<int, MAX_PLY>, 2> killerMoves; // [id][ply]
-// Quiet moves that updated the alpha value
-std::array<std::array<int, 64>, 12> historyMoves;      // [piece][square]
-std::array<int, MAX_PLY> pvLength;                     // [ply]
-std::array<std::array<int, MAX_PLY>, MAX_PLY> pvTable; // [ply][ply]
+// Quiet moves that caused a beta-cutoff in reply to the previous move
+thread_local std::array<std::array<int, 64>, 12> counterMoves; // [prevPiece][prevTarget]
+// Quiet move history, bounded by MAX_HISTORY
+thread_local std::array<std::array<int, 64>, 12> historyMoves; // [piece][square]
+// Quiet move history in reply to the moves 1 and 2 plies earlier
+thread_local std::array<std::array<ContHistEntry, 64>, 12> contHistory; // [prevPiece][prevTarget]
+// Capture history, used to order captures with the same victim
+thread_local std::array<std::array<std::array<int16_t, 6>, 64>, 12>
+    captureHistory;                                                 // [piece][target][captured]
+thread_local std::array<int, MAX_PLY + 1> pvLength;                 // [ply]
+thread_local std::array<std::array<int, MAX_PLY>, MAX_PLY> pvTable; // [ply][ply]
 
 // PV flags
-bool followPV, scorePV;
+thread_local bool followPV, scorePV;
+
+thread_local int multiPV = 1;
+// Legal root moves when more than one line is searched, the lines found first; empty
+// otherwise, in which case the root is searched like any other node
+thread_local std::vector<RootMove> rootMoves;
+// Line being searched; root moves before it are left out
+thread_local int pvIndex;
+
+void init()
+{
+    for (int depth = 0; depth < MAX_PLY; depth++) {
+        for (int moveNum = 0; moveNum < 256; moveNum++) {
+            if (depth == 0 || moveNum == 0)
+                reductions[depth][moveNum] = 0;
+            else
+                reductions[depth][moveNum] =
+                    (int)(0.75 + std::log(depth) * std::log(moveNum) / 2.25);
+        }
+    }
+    for (int depth = 0; depth <= LMP_DEPTH; depth++) {
+        lateMoveCount[0][depth] = (3 + depth * depth) / 2;
+        lateMoveCount[1][depth] = 3 + depth * depth;
+    }
+}
 
 void clearSearchTable()
 {
-    for (auto& elem : killerMoves)
+    for (auto& elem : counterMoves)
         elem.fill(0);
     for (auto& elem : historyMoves)
         elem.fill(0);
+    for (auto& prevPiece : contHistory)
+        for (auto& prevTarget : prevPiece)
+            for (auto& elem : prevTarget)
+                elem.fill(0);
+    for (auto& piece : captureHistory)
+        for (auto& elem : piece)
+            elem.fill(0);
     for (auto& elem : pvTable)
         elem.fill(0);
     pvLength.fill(0);
+    searchStack.fill(SearchStack());
+}
+
+void clearKeyHistory()
+{
+    gamePly = 0;
+}
+
+// Record a position of the game that leads up to the root
+void addGameKey(const Board& board)
+{
+    // Drop the oldest key once full; it is long past any irreversible move
+    if (gamePly == MAX_GAME_PLY) {
+        std::copy(keyHistory.begin() + 1, keyHistory.begin() + MAX_GAME_PLY, keyHistory.begin());
+        gamePly--;
+    }
+    keyHistory[gamePly++] = board.state.posKey;
 }
 
-void position(Board& board, const int depth)
+// Has the position occurred before since the last irreversible move?
+// Only positions with the same side to move are compared, and a single repetition is
+// scored as a draw since the side ahead could repeat it again
+bool isRepetition(const Board& board)
 {
-    int score = 0;
+    int current = gamePly + ply;
+    int oldest = std::max(0, current - board.state.halfMoves);
+    for (int i = current - 2; i >= oldest; i -= 2)
+        if (keyHistory[i] == board.state.posKey)
+            return true;
+    return false;
+}
+
+SearchResult position(Board& board, const int depth, const bool print)
+{
+    SearchResult result;
+    int score = 0, prevScore = 0;
+    // Running average of how much the score changes between iterations
+    int volatility = 0;
     nodes = 0L;
     followPV = false;
     scorePV = false;
+    stats = SearchStats();
+    Eval::evalStats = Eval::EvalStats();
     clearSearchTable();
+    if (NNUE::enabled())
+        NNUE::reset(board);
     UCI::stop = false;
-    int alpha = -INF, beta = INF;
-    int64_t totalTime = 1;
+    rootMoves.clear();
+    if (multiPV > 1) {
+        Move::MoveList legal;
+        Move::generateLegal(legal, board);
+        if (legal.count > 1)
+            for (int i = 0; i < legal.count; i++)
+                rootMoves.push_back({legal.list[i], -INF, {}, 0});
+    }
+    int64_t startTime = Time::now();
     for (int currDepth = 1; currDepth <= depth; currDepth++) {
         if (UCI::stop)
             break;
-        // Enable followPV
-        followPV = true;
 
-        Time::start();
+        uint64_t iterStartNodes = nodes;
+        rootDepth = currDepth;
+
+        if (!rootMoves.empty()) {
+            score = searchMultiPV(board, currDepth, volatility);
+            if (UCI::stop)
+                break;
+            // The best line becomes the PV of the iteration
+            pvLength[0] = (int)rootMoves[0].pv.size();
+            std::copy(rootMoves[0].pv.begin(), rootMoves[0].pv.end(), pvTable[0].begin());
+        }
 
-        score = negamax(&board, alpha, beta, currDepth);
-        totalTime += Time::end();
         // Aspiration window
-        if ((score <= alpha) || (score >= beta)) {
-            alpha = -INF;
-            beta = INF;
-            continue;
+        // Search with a window around the previous score; the more the score has been
+        // jumping around, the wider the initial window
+        int alpha = -INF, beta = INF;
+        int delta = ASPIRATION_DELTA + volatility;
+        if (currDepth >= ASPIRATION_DEPTH && std::abs(prevScore) < MATE_SCORE) {
+            alpha = std::max(prevScore - delta, -INF);
+            beta = std::min(prevScore + delta, INF);
         }
-        // Set up the window for the next iteration
-        alpha = score - 50;
-        beta = score + 50;
-        if (pvLength[0]) {
-            std::cout << "info score ";
-            getCPOrMateScore(score);
-            std::cout << " depth " << currDepth << " nodes " << nodes << " time " << totalTime
-                      << " nps " << (uint64_t)((nodes * 1000) / (float)totalTime) << " pv";
-            for (int i = 0; i < pvLength[0]; i++)
-                std::cout << " " << Move::toString(pvTable[0][i]);
-            std::cout << "\n";
+        while (rootMoves.empty()) {
+            // Enable followPV
+            followPV = true;
+            score = negamax(&board, alpha, beta, currDepth);
+            if (UCI::stop)
+                break;
+
+            // Re-search the same depth, widening the window on the failing side only
+            if (score <= alpha) {
+                if (print)
+                    printInfo(score, currDepth, Time::now() - startTime, " upperbound");
+                alpha = std::max(alpha - delta, -INF);
+            } else if (score >= beta) {
+                if (print)
+                    printInfo(score, currDepth, Time::now() - startTime, " lowerbound");
+                beta = std::min(beta + delta, INF);
+            } else
+                break;
+            stats.aspirationResearches++;
+            delta += delta / 2;
         }
+        if (UCI::stop)
+            break;
+
+        stats.prevIterNodes = stats.lastIterNodes;
+        stats.lastIterNodes = nodes - iterStartNodes;
+        if (currDepth > 1)
+            volatility = (volatility + std::abs(score - prevScore)) / 2;
+        prevScore = score;
+        int64_t bestMoveTime = result.bestMoveTime;
+        uint64_t bestMoveNodes = result.bestMoveNodes;
+        if (pvTable[0][0] != result.bestMove) {
+            bestMoveTime = Time::now() - startTime;
+            bestMoveNodes = nodes;
+        }
+        result = {pvTable[0][0], score, currDepth,
+                  std::vector<int>(pvTable[0].begin(), pvTable[0].begin() + pvLength[0]),
+                  bestMoveTime, bestMoveNodes};
+        if (print && rootMoves.empty())
+            printInfo(score, currDepth, Time::now() - startTime);
+        for (int i = 0; print && i < std::min<int>(multiPV, (int)rootMoves.size()); i++)
+            printInfo(rootMoves[i].score, currDepth, Time::now() - startTime, "", i + 1);
     }
-    std::cout << "bestmove " << Move::toString(pvTable[0][0]) << "\n";
+    // The root PV of an interrupted iteration may be incomplete, so the move of the last
+    // completed one is played unless there is none
+    if (!result.bestMove)
+        result.bestMove = pvTable[0][0];
+    if (print) {
+        UCI::waitForStop();
+        printStats();
+        std::cout << "bestmove " << Move::toString(result.bestMove);
+        // The expected reply, which the GUI may let us search during the opponent's time
+        if (result.pv.size() >= 2 && result.pv[0] == result.bestMove)
+            std::cout << " ponder " << Move::toString(result.pv[1]);
+        std::cout << "\n";
+    }
+    return result;
+}
+
+// Searches the best 'multiPV' root moves one after the other, each leaving out the ones found
+// before it, with an aspiration window around the score of the same line in the previous
+// iteration. The lines are moved to the front of rootMoves in order, and the other moves are
+// sorted by the nodes spent on them so the next iteration tries the most promising first.
+int searchMultiPV(Board& board, const int depth, const int volatility)
+{
+    int lines = std::min<int>(multiPV, (int)rootMoves.size());
+    for (RootMove& rootMove : rootMoves)
+        rootMove.nodes = 0;
+    for (pvIndex = 0; pvIndex < lines; pvIndex++) {
+        RootMove& line = rootMoves[pvIndex];
+        int prevScore = line.score, score;
+        // Follow the PV of the line searched from here last time
+        std::copy(line.pv.begin(), line.pv.end(), pvTable[0].begin());
+        int alpha = -INF, beta = INF;
+        int delta = ASPIRATION_DELTA + volatility;
+        if (depth >= ASPIRATION_DEPTH && std::abs(prevScore) < MATE_SCORE) {
+            alpha = std::max(prevScore - delta, -INF);
+            beta = std::min(prevScore + delta, INF);
+        }
+        while (true) {
+            followPV = true;
+            score = negamax(&board, alpha, beta, depth);
+            if (UCI::stop)
+                return 0;
+            if (score <= alpha)
+                alpha = std::max(alpha - delta, -INF);
+            else if (score >= beta)
+                beta = std::min(beta + delta, INF);
+            else
+                break;
+            stats.aspirationResearches++;
+            delta += delta / 2;
+        }
+
+        auto found = std::find_if(rootMoves.begin() + pvIndex, rootMoves.end(),
+                                  [](const RootMove& rootMove) {
+                                      return rootMove.move == pvTable[0][0];
+                                  });
+        found->score = score;
+        found->pv.assign(pvTable[0].begin(), pvTable[0].begin() + pvLength[0]);
+        std::rotate(rootMoves.begin() + pvIndex, found, found + 1);
+    }
+    pvIndex = 0;
+    std::stable_sort(rootMoves.begin() + lines, rootMoves.end(),
+                     [](const RootMove& a, const RootMove& b) { return a.nodes > b.nodes; });
+    for (auto it = rootMoves.begin() + lines; it != rootMoves.end(); ++it)
+        it->score = -INF;
+    return rootMoves[0].score;
+}
+
+void printInfo(const int score, const int depth, int64_t totalTime, const std::string& bound,
+               const int line)
+{
+    totalTime = std::max(totalTime, (int64_t)1);
+    std::cout << "info ";
+    if (line)
+        std::cout << "multipv " << line << " ";
+    std::cout << "score ";
+    getCPOrMateScore(score);
+    std::cout << bound << " depth " << depth << " nodes " << nodes << " time " << totalTime
+              << " nps " << (uint64_t)((nodes * 1000) / (float)totalTime);
+    const int* pv = line ? rootMoves[line - 1].pv.data() : pvTable[0].data();
+    int pvSize = line ? (int)rootMoves[line - 1].pv.size() : pvLength[0];
+    if (pvSize) {
+        std::cout << " pv";
+        for (int i = 0; i < pvSize; i++)
+            std::cout << " " << Move::toString(pv[i]);
+    }
+    std::cout << "\n";
+}
+
+void printStats()
+{
+    // Effective branching factor of the last completed iteration
+    double ebf = stats.prevIterNodes ? (double)stats.lastIterNodes / stats.prevIterNodes : 0.0;
+    // Share of the nodes searched by the quiescence search
+    double qsearchShare = nodes ? (double)stats.qsearchNodes / nodes : 0.0;
+    // Share of beta-cutoffs caused by the first move searched
+    double firstCutRate =
+        stats.betaCutoffs ? (double)stats.firstMoveCutoffs / stats.betaCutoffs : 0.0;
+    // Share of evaluations that skipped everything but material and piece-square tables
+    double lazyRate = Eval::evalStats.evals
+                          ? (double)Eval::evalStats.lazySkips / Eval::evalStats.evals
+                          : 0.0;
+    double evalCacheHitRate = Eval::evalStats.evals
+                                  ? (double)Eval::evalStats.cacheHits / Eval::evalStats.evals
+                                  : 0.0;
+    std::cout << "info string ebf " << ebf << " first-move-cutoffs " << firstCutRate << " lmr "
+              << stats.lmrSearches << " lmr-researches " << stats.lmrResearches << " lmp "
+              << stats.lmpPrunes << " probcut " << stats.probCuts << " singular "
+              << stats.singularExtensions << " multi-cut " << stats.multiCuts << " qsearch-nodes "
+              << qsearchShare << " delta " << stats.deltaPrunes << " aspiration-researches "
+              << stats.aspirationResearches << " lazy-evals " << lazyRate
+              << " eval-cache-hits " << evalCacheHitRate << "\n";
 }
 
 void getCPOrMateScore(const int& score)
@@ -105,55 +361,90 @@ int negamax(Board* board, int alpha, int beta, int depth)
     pvLength[ply] = ply;
     int score;
     TT::TTFlags hashFlag = TT::F_ALPHA;
+    SearchStack& ss = searchStack[ply];
 
     bool isPVNode = (beta - alpha) > 1;
+    // Singular extension verification searches skip a move, so their results can't be
+    // exchanged with the transposition table
+    int excludedMove = ss.excludedMove;
+
+    // Draw by repetition or by the fifty-move rule
+    if (ply > 0 && (board->state.halfMoves >= 100 || isRepetition(*board)))
+        return DRAW_SCORE;
+    keyHistory[gamePly + ply] = board->state.posKey;
 
     // Read score from transposition table if position already exists inside the
     // table
-    if (ply > 0 && (score = TT::readEntry(*board, alpha, beta, depth)) != TT::NO_ENTRY && !isPVNode)
+    TT::TTEntry ttEntry;
+    bool ttHit = !excludedMove && TT::probeEntry(*board, ttEntry);
+    int ttMove = ttHit ? ttEntry.move : 0;
+    if (ply > 0 && ttHit && !isPVNode &&
+        (score = TT::readEntry(ttEntry, alpha, beta, depth)) != TT::NO_ENTRY)
         return score;
 
-    // every 2047 nodes
-    if ((nodes & 2047) == 0)
+    // every 2^CHECK_INTERVAL_BITS nodes
+    if ((nodes & ((1ULL << CHECK_INTERVAL_BITS) - 1)) == 0)
         // "listen" to the GUI/user input
         UCI::checkUp();
 
     // Escape condition
-    if (depth == 0)
+    // Reductions can overshoot the remaining depth when their parameters are tuned
+    if (depth <= 0)
         return quiescence(board, alpha, beta);
 
-    // Exit if ply > max ply; ply should be <= 63
+    // Exit if ply > max ply; ply should be < MAX_PLY
     if (ply > MAX_PLY - 1)
         return Eval::EvalPosition(*board);
     // Increment nodes
     nodes++;
 
     // Is the king in check?
-    bool inCheck = board->isInCheck();
+    bool inCheck = board->sideInCheck();
+    ss.inCheck = inCheck;
 
     // Check extension
-    if (inCheck)
+    // Limited to the first 2 * rootDepth plies so that perpetual checks can't grow the tree
+    // without bound
+    if (inCheck && ply < 2 * rootDepth)
         depth++;
 
+    // Static evaluation is meaningless when in check
+    int staticEval = inCheck ? -INF : Eval::EvalPosition(*board);
+    ss.staticEval = staticEval;
+    // Has the side to move's position improved since its last move?
+    bool improving = !inCheck && (ply < 2 || searchStack[ply - 2].inCheck ||
+                                  staticEval > searchStack[ply - 2].staticEval);
+
     int legalMoves = 0;
+    Board clone;
 
     // NULL move pruning
-    if (depth >= 3 && !inCheck && ply) {
+    // Not done twice in a row, nor when the static evaluation is already below beta
+    if (depth >= 3 && !inCheck && ply && !excludedMove && searchStack[ply - 1].currentMove &&
+        staticEval >= beta) {
         Board anotherClone = *board;
+        ss.currentMove = 0;
+        ss.contHist = nullptr;
         ply++;
         // Hash enpassant if available
         if (board->state.enpassant != Sq::noSq)
             Zobrist::toggleEnpass(*board, (int)board->state.enpassant);
         // Reset enpassant
         board->state.enpassant = Sq::noSq;
+        // Repetitions can't span the null move
+        board->state.halfMoves = 0;
 
         // Give opponent an extra move; 2 moves in one turn
         board->state.changeSide();
         // Hash the extra turn given by hashing the side one more time
         Zobrist::toggleSide(*board);
+        // No pieces moved
+        board->evalState.dirty = DirtyPieces();
+        if (NNUE::enabled())
+            NNUE::push(*board);
 
         // Search move with reduced depth to find beta-cutoffs
-        score = -negamax(board, -beta, -beta + 1, depth - 1 - 2);
+        score = -negamax(board, -beta, -beta + 1, std::max(depth - 1 - NULL_MOVE_REDUCTION, 0));
 
         ply--;
         *board = anotherClone;
@@ -164,20 +455,132 @@ int negamax(Board* board, int alpha, int beta, int depth)
             return beta;
     }
 
+    // ProbCut
+    // If a good capture beats beta by a wide margin in a reduced depth search, the full
+    // depth search would most likely fail high as well
+    int probCutBeta = beta + PROBCUT_MARGIN;
+    if (!isPVNode && !inCheck && depth >= PROBCUT_DEPTH && !excludedMove &&
+        std::abs(beta) < MATE_SCORE &&
+        !(ttHit && ttEntry.depth >= depth - 3 && ttEntry.score < probCutBeta)) {
+        Move::MoveList captureList;
+        Move::generate(captureList, *board);
+        sortMoves(captureList, *board, ttMove);
+
+        for (int i = 0; i < captureList.count; i++) {
+            int move = captureList.list[i];
+            if (!Move::isCapture(move) || !Move::see(*board, move, probCutBeta - staticEval))
+                continue;
+
+            clone = *board;
+            ss.currentMove = move;
+            ss.contHist = &contHistory[Move::getPiece(move)][Move::getTarget(move)];
+            ply++;
+            if (!Move::make(board, move, Move::MoveType::onlyCaptures)) {
+                ply--;
+                continue;
+            }
+            if (NNUE::enabled())
+                NNUE::push(*board);
+
+            // Verify with quiescence search before doing the reduced depth search
+            score = -quiescence(board, -probCutBeta, -probCutBeta + 1);
+            if (score >= probCutBeta)
+                score = -negamax(board, -probCutBeta, -probCutBeta + 1, depth - 4);
+
+            ply--;
+            *board = clone;
+            if (UCI::stop)
+                return 0;
+
+            if (score >= probCutBeta) {
+                stats.probCuts++;
+                TT::writeEntry(*board, depth - 3, score, TT::F_BETA, move);
+                return beta;
+            }
+        }
+    }
+
+    // Singular extension
+    // If every move but the TT move fails low against a margin below the TT score, the TT
+    // move is the only one holding the position and gets searched one ply deeper
+    int singularExtension = 0;
+    if (ply > 0 && depth >= SINGULAR_DEPTH && ttMove && ply < 2 * rootDepth &&
+        ttEntry.flag != TT::F_ALPHA && ttEntry.depth >= depth - 3 &&
+        std::abs(ttEntry.score) < MATE_SCORE) {
+        int singularBeta = ttEntry.score - 2 * depth;
+
+        ss.excludedMove = ttMove;
+        score = negamax(board, singularBeta - 1, singularBeta, (depth - 1) / 2);
+        ss.excludedMove = 0;
+        if (UCI::stop)
+            return 0;
+
+        if (score < singularBeta) {
+            stats.singularExtensions++;
+            singularExtension = 1;
+        }
+        // Multi-cut
+        // Another move beats a bound that is already above beta; together with the TT move,
+        // more than one move fails high
+        else if (singularBeta >= beta) {
+            stats.multiCuts++;
+            return beta;
+        }
+    }
+
     // Generate and sort moves
+    // With several lines, the root searches the moves not yet taken by a line, in the order
+    // of the previous iteration
+    bool multiPVRoot = ply == 0 && !rootMoves.empty();
     Move::MoveList moveList;
-    Move::generate(moveList, *board);
-    if (followPV)
-        enablePVScoring(moveList);
-    sortMoves(moveList, *board);
+    if (multiPVRoot) {
+        for (int i = pvIndex; i < (int)rootMoves.size(); i++)
+            moveList.add(rootMoves[i].move);
+    } else {
+        Move::generate(moveList, *board);
+        if (followPV)
+            enablePVScoring(moveList);
+        sortMoves(moveList, *board, ttMove);
+    }
 
-    Board clone;
     int movesSearched = 0;
+    int bestMove = 0;
+    // Moves that were searched without causing a beta-cutoff or becoming the best move
+    std::array<int, 64> quietsTried, capturesTried;
+    int quietCount = 0, captureCount = 0;
+    // Number of them searched before the best move; the later ones were never compared with it
+    int quietsBeforeBest = 0, capturesBeforeBest = 0;
+    // Remember a move for the history penalties
+    auto addTried = [&](const int move) {
+        if (!Move::isCapture(move) && Move::getPromoted(move) == (int)Piece::E) {
+            if (quietCount < 64)
+                quietsTried[quietCount++] = move;
+        } else if (Move::isCapture(move) && captureCount < 64)
+            capturesTried[captureCount++] = move;
+    };
     // Loop over all the generated moves
     for (int i = 0; i < moveList.count; i++) {
+        if (moveList.list[i] == excludedMove)
+            continue;
+
+        bool isQuiet = !Move::isCapture(moveList.list[i]) &&
+                       Move::getPromoted(moveList.list[i]) == (int)Piece::E;
+        int quietHistory = isQuiet ? getQuietHistory(moveList.list[i]) : 0;
+
+        // Late move pruning (LMP)
+        // Skip the remaining quiet moves at shallow depths once enough moves were searched
+        if (!isPVNode && !inCheck && isQuiet && depth <= LMP_DEPTH && alpha > -MATE_SCORE &&
+            movesSearched >= lateMoveCount[improving][depth]) {
+            stats.lmpPrunes++;
+            continue;
+        }
+
         // Bookmark current state of board
         clone = *board;
 
+        ss.currentMove = moveList.list[i];
+        ss.contHist = &contHistory[Move::getPiece(moveList.list[i])]
+                                  [Move::getTarget(moveList.list[i])];
         // Increment half move
         ply++;
 
@@ -187,37 +590,60 @@ int negamax(Board* board, int alpha, int beta, int depth)
             ply--;
             continue;
         }
+        if (NNUE::enabled())
+            NNUE::push(*board);
 
         // Increment legal moves
         legalMoves++;
+        uint64_t moveStartNodes = nodes;
+
+        int newDepth = depth - 1 + (moveList.list[i] == ttMove ? singularExtension : 0);
 
         // Full depth search
         if (movesSearched == 0)
             // Do normal alpha-beta search
-            score = -negamax(board, -beta, -alpha, depth - 1);
+            score = -negamax(board, -beta, -alpha, newDepth);
         else // Late move reduction (LMR)
         {
+            int reduction = 0;
             if (movesSearched >= FULL_DEPTH_MOVES && depth >= REDUCTION_LIMIT && !inCheck &&
-                Move::getPromoted(moveList.list[i]) == (int)Piece::E &&
-                !Move::isCapture(moveList.list[i]))
-                score = -negamax(board, -alpha - 1, -alpha, depth - 2);
-            else
+                isQuiet) {
+                reduction = reductions[std::min(depth, MAX_PLY - 1)][std::min(movesSearched, 255)];
+                // Reduce less in PV nodes and more when the position isn't improving
+                reduction -= isPVNode;
+                reduction += !improving;
+                // Reduce less for killers and for moves with good history
+                reduction -=
+                    (moveList.list[i] == ss.killers[0] || moveList.list[i] == ss.killers[1]);
+                reduction -= quietHistory / HISTORY_REDUCTION_DIVISOR;
+                // Always leave at least one ply to search
+                reduction = std::clamp(reduction, 0, depth - 2);
+            }
+
+            if (reduction > 0) {
+                stats.lmrSearches++;
+                score = -negamax(board, -alpha - 1, -alpha, newDepth - reduction);
+                if (score > alpha)
+                    stats.lmrResearches++;
+            } else
                 // Hack to ensure full depth search is done
                 score = alpha + 1;
 
             // PVS (Principal Variation Search)
             if (score > alpha) {
                 // re-search at full depth but with narrowed score bandwith
-                score = -negamax(board, -alpha - 1, -alpha, depth - 1);
+                score = -negamax(board, -alpha - 1, -alpha, newDepth);
 
                 // if LMR fails re-search at full depth and full score bandwith
                 if ((score > alpha) && (score < beta))
-                    score = -negamax(board, -beta, -alpha, depth - 1);
+                    score = -negamax(board, -beta, -alpha, newDepth);
             }
         }
         // Decrement ply and restore board state
         ply--;
         *board = clone;
+        if (multiPVRoot)
+            rootMoves[pvIndex + i].nodes += nodes - moveStartNodes;
 
         if (UCI::stop)
             return 0;
@@ -228,10 +654,12 @@ int negamax(Board* board, int alpha, int beta, int depth)
         if (score > alpha) {
             // Switch flag to EXACT(PV node) from ALPHA (fail-low node)
             hashFlag = TT::F_EXACT;
-            if (!Move::isCapture(moveList.list[i]))
-                // Store history move
-                historyMoves[Move::getPiece(moveList.list[i])][Move::getTarget(moveList.list[i])] +=
-                    depth;
+            // The previous best move was searched before this one and is beaten by it
+            if (bestMove)
+                addTried(bestMove);
+            bestMove = moveList.list[i];
+            quietsBeforeBest = quietCount;
+            capturesBeforeBest = captureCount;
 
             // Principal Variation (PV) node
             alpha = score;
@@ -246,19 +674,23 @@ int negamax(Board* board, int alpha, int beta, int depth)
             // Fail-hard beta cutoff
             if (score >= beta) {
                 // Store hash entry with score equal to beta
-                TT::writeEntry(*board, depth, beta, TT::F_BETA);
-
-                if (!Move::isCapture(moveList.list[i])) {
-                    // Move 1st killer move to 2nd killer move
-                    killerMoves[1][ply] = killerMoves[0][ply];
-                    // Update 1st killer move to current move
-                    killerMoves[0][ply] = moveList.list[i];
-                }
+                if (!excludedMove)
+                    TT::writeEntry(*board, depth, beta, TT::F_BETA, bestMove);
+
+                stats.betaCutoffs++;
+                if (movesSearched == 1)
+                    stats.firstMoveCutoffs++;
+                updateHistories(*board, bestMove, depth, quietsTried, quietCount, capturesTried,
+                                captureCount);
                 // Move that fails high
                 return beta;
             }
-        }
+        } else
+            addTried(moveList.list[i]);
     }
+    // All the other moves failed low in a verification search
+    if (legalMoves == 0 && excludedMove)
+        return alpha;
     // If no legal moves, it's either checkmate or stalemate
     if (legalMoves == 0) {
         // If check, return checkmate score
@@ -268,62 +700,115 @@ int negamax(Board* board, int alpha, int beta, int depth)
         else
             return 0;
     }
+    // Reward the best move of a PV node as well
+    if (bestMove)
+        updateHistories(*board, bestMove, depth, quietsTried, quietsBeforeBest, capturesTried,
+                        capturesBeforeBest);
     // Store hash entry with score equal to alpha
-    TT::writeEntry(*board, depth, alpha, hashFlag);
+    if (!excludedMove)
+        TT::writeEntry(*board, depth, alpha, hashFlag, bestMove);
     // Move that failed low
     return alpha;
 }
 
-int quiescence(Board* board, int alpha, int beta)
+int quiescence(Board* board, int alpha, int beta, const int qsPly)
 {
-    // every 2047 nodes
-    if ((nodes & 2047) == 0)
+    // every 2^CHECK_INTERVAL_BITS nodes
+    if ((nodes & ((1ULL << CHECK_INTERVAL_BITS) - 1)) == 0)
         // "listen" to the GUI/user input
         UCI::checkUp();
 
     // Increment nodes
     nodes++;
+    stats.qsearchNodes++;
 
-    // Escape condition - fail-hard beta cutoff
-    int positionEval = Eval::EvalPosition(*board);
-
-    // Exit if ply > max ply; ply should be <= 63
+    // Exit if ply > max ply; ply should be < MAX_PLY
     if (ply > MAX_PLY - 1)
-        return positionEval;
+        return Eval::EvalPosition(*board);
 
-    // Fail-hard beta cutoff
-    if (positionEval >= beta)
-        // Move that fails high
-        return beta;
+    int score;
+    int originalAlpha = alpha;
+    bool isPVNode = (beta - alpha) > 1;
 
-    // If current move is better, update move
-    if (positionEval > alpha)
-        // Principal Variation (PV) node
-        alpha = positionEval;
+    // Read score from transposition table; any stored depth is deep enough
+    TT::TTEntry ttEntry;
+    bool ttHit = TT::probeEntry(*board, ttEntry);
+    int ttMove = ttHit ? ttEntry.move : 0;
+    if (ttHit && !isPVNode && (score = TT::readEntry(ttEntry, alpha, beta, 0)) != TT::NO_ENTRY)
+        return score;
+
+    // Standing pat isn't an option when in check; every evasion has to be searched
+    bool inCheck = board->sideInCheck();
+    // Stand-pat only needs an exact score close to the window
+    int positionEval = inCheck ? -INF : Eval::EvalPosition(*board, alpha, beta);
+
+    if (!inCheck) {
+        // Fail-hard beta cutoff
+        if (positionEval >= beta) {
+            TT::writeEntry(*board, 0, beta, TT::F_BETA);
+            // Move that fails high
+            return beta;
+        }
+
+        // If current move is better, update move
+        if (positionEval > alpha)
+            // Principal Variation (PV) node
+            alpha = positionEval;
+    }
 
     // Generate and sort moves
     Move::MoveList moveList;
     Move::generate(moveList, *board);
-    sortMoves(moveList, *board);
+    sortMoves(moveList, *board, ttMove);
+
+    // Quiet moves that give a direct check are searched at the first quiescence ply
+    std::array<uint64_t, 6> checkSquares{};
+    if (!inCheck && qsPly == 0)
+        checkSquares = getCheckSquares(*board);
 
     Board clone;
+    int legalMoves = 0;
+    int bestMove = 0;
     // Loop over all the generated moves
     for (int i = 0; i < moveList.count; i++) {
+        int move = moveList.list[i];
+        if (!inCheck) {
+            if (!Move::isCapture(move)) {
+                if (!getBit(checkSquares[Move::getPiece(move) % 6], Move::getTarget(move)))
+                    continue;
+            }
+            // Delta pruning
+            // Skip captures that can't raise the score above alpha even with a safety margin
+            else if (Move::getPromoted(move) == (int)Piece::E &&
+                     positionEval + Eval::PIECE_VALUES[(int)Eval::Phase::EG]
+                                                      [getCapturedType(*board, move)] +
+                             DELTA_MARGIN <=
+                         alpha) {
+                stats.deltaPrunes++;
+                continue;
+            }
+        }
+
         // Bookmark current state of board
         clone = *board;
 
+        searchStack[ply].currentMove = move;
+        searchStack[ply].contHist = &contHistory[Move::getPiece(move)][Move::getTarget(move)];
         // Increment half move
         ply++;
 
         // Play move if move is legal
-        if (!Move::make(board, moveList.list[i], Move::MoveType::onlyCaptures)) {
+        if (!Move::make(board, move, Move::MoveType::allMoves)) {
             // Decrement move and move onto next move
             ply--;
             continue;
         }
+        if (NNUE::enabled())
+            NNUE::push(*board);
+        legalMoves++;
 
         // Score current move
-        int score = -quiescence(board, -beta, -alpha);
+        score = -quiescence(board, -beta, -alpha, qsPly + 1);
 
         // Decrement ply and restore board state
         ply--;
@@ -335,18 +820,43 @@ int quiescence(Board* board, int alpha, int beta)
         // If current move is better, update move
         if (score > alpha) {
             alpha = score;
+            bestMove = move;
 
             // Fail-hard beta cutoff
-            if (score >= beta)
+            if (score >= beta) {
+                TT::writeEntry(*board, 0, beta, TT::F_BETA, bestMove);
                 // Move that fails high
                 return beta;
+            }
         }
         // Principal Variation (PV) node
     }
+    // Checkmate
+    if (inCheck && legalMoves == 0)
+        return -MATE_VALUE + ply;
+
+    TT::writeEntry(*board, 0, alpha, alpha > originalAlpha ? TT::F_EXACT : TT::F_ALPHA, bestMove);
     // Move that failed low
     return alpha;
 }
 
+// Squares from which each piece type of the side to move attacks the enemy king
+std::array<uint64_t, 6> getCheckSquares(const Board& board)
+{
+    int kingSq = Bitboard::lsbIndex(
+        board.pos.pieces[board.state.side == Color::WHITE ? (int)Piece::k : (int)Piece::K]);
+    uint64_t occupancy = board.pos.units[(int)Color::BOTH];
+
+    std::array<uint64_t, 6> checkSquares{};
+    checkSquares[(int)PieceTypes::PAWN] = Attack::pawnAttacks[(int)board.state.xside][kingSq];
+    checkSquares[(int)PieceTypes::KNIGHT] = Attack::knightAttacks[kingSq];
+    checkSquares[(int)PieceTypes::BISHOP] = Magics::getBishopAttack(kingSq, occupancy);
+    checkSquares[(int)PieceTypes::ROOK] = Magics::getRookAttack(kingSq, occupancy);
+    checkSquares[(int)PieceTypes::QUEEN] =
+        checkSquares[(int)PieceTypes::BISHOP] | checkSquares[(int)PieceTypes::ROOK];
+    return checkSquares;
+}
+
 void printMoveScores(const Move::MoveList& moveList, const Board& board)
 {
     std::cout << "Move scores: \n";
@@ -355,12 +865,12 @@ void printMoveScores(const Move::MoveList& moveList, const Board& board)
                   << scoreMoves(board, moveList.list[i]) << "\n";
 }
 
-void sortMoves(Move::MoveList& moveList, const Board& board)
+void sortMoves(Move::MoveList& moveList, const Board& board, const int ttMove)
 {
     std::array<int, 256> moveScores;
     // Initialize moveScores with move scores
     for (int i = 0; i < moveList.count; i++)
-        moveScores[i] = scoreMoves(board, moveList.list[i]);
+        moveScores[i] = scoreMoves(board, moveList.list[i], ttMove);
 
     // Sort moves based on scores
     for (int i = 0; i < moveList.count; i++) {
@@ -381,45 +891,126 @@ void sortMoves(Move::MoveList& moveList, const Board& board)
 
 /*
         Move Scoring Order or Priority
-          1. PV moves        ( = 20,000 pts)
-          2. MVV LVA move    (>= 10,000 pts)
-          3. 1st killer move ( =  9,000 pts)
-          4. 2nd killer move ( =  8,000 pts)
-          5. History move
-          6. Unsorted move
+          1. PV moves        ( = 2,000,000 pts)
+          2. TT move         ( = 1,000,000 pts)
+          3. MVV LVA move    (>=   500,000 pts) + capture history
+          4. 1st killer move ( =   400,000 pts)
+          5. 2nd killer move ( =   300,000 pts)
+          6. Counter move    ( =   200,000 pts)
+          7. History move    (main + continuation history)
 */
-int scoreMoves(const Board& board, const int move)
+int scoreMoves(const Board& board, const int move, const int ttMove)
 {
     // PV (Principal variation move) scoring
     if (scorePV && pvTable[0][ply] == move) {
         scorePV = false;
-        return 20'000;
+        return 2'000'000;
     }
+    // Best move found by an earlier search of this position
+    if (move == ttMove)
+        return 1'000'000;
     // Capture move scoring
     if (Move::isCapture(move)) {
-        int victimPiece = (int)Piece::P;
-        for (int bbPiece = (board.state.side == Color::WHITE ? (int)Piece::p : (int)Piece::P);
-             bbPiece <= (board.state.side == Color::WHITE ? (int)Piece::k : (int)Piece::K);
-             bbPiece++) {
-            if (getBit(board.pos.pieces[bbPiece], Move::getTarget(move))) {
-                victimPiece = bbPiece;
-                break;
-            }
-        }
-        return mvvLva[Move::getPiece(move) % 6][victimPiece % 6] + 10'000;
+        int captured = getCapturedType(board, move);
+        // Capture history only reorders captures of the same victim
+        return mvvLva(Move::getPiece(move) % 6, captured) + 500'000 +
+               captureHistory[Move::getPiece(move)][Move::getTarget(move)][captured] / 256;
     }
     // Quiet move scoring
     else {
         // Score 1st killer move
-        if (killerMoves[0][ply] == move)
-            return 9'000;
+        if (searchStack[ply].killers[0] == move)
+            return 400'000;
         // Score 2nd killer move
-        else if (killerMoves[1][ply] == move)
-            return 8'000;
+        else if (searchStack[ply].killers[1] == move)
+            return 300'000;
+        // Score counter move
+        else if (ply > 0 && searchStack[ply - 1].currentMove &&
+                 counterMoves[Move::getPiece(searchStack[ply - 1].currentMove)]
+                             [Move::getTarget(searchStack[ply - 1].currentMove)] == move)
+            return 200'000;
         // Score history moves
         else
-            return historyMoves[Move::getPiece(move)][Move::getTarget(move)];
+            return getQuietHistory(move);
+    }
+}
+
+int getCapturedType(const Board& board, const int move)
+{
+    // Enpassant captures leave the target square empty, so default to a pawn
+    int victimPiece = (int)Piece::P;
+    for (int bbPiece = (board.state.side == Color::WHITE ? (int)Piece::p : (int)Piece::P);
+         bbPiece <= (board.state.side == Color::WHITE ? (int)Piece::k : (int)Piece::K); bbPiece++) {
+        if (getBit(board.pos.pieces[bbPiece], Move::getTarget(move))) {
+            victimPiece = bbPiece;
+            break;
+        }
+    }
+    return victimPiece % 6;
+}
+
+// Main history plus the continuation history of the moves 1 and 2 plies earlier
+int getQuietHistory(const int move)
+{
+    int piece = Move::getPiece(move), target = Move::getTarget(move);
+    int score = historyMoves[piece][target];
+    for (int back = 1; back <= 2 && ply - back >= 0; back++) {
+        if (ContHistEntry* contHist = searchStack[ply - back].contHist)
+            score += (*contHist)[piece][target];
+    }
+    return score;
+}
+
+// Gravity update: the closer an entry is to MAX_HISTORY, the smaller the change
+template <typename T> inline void applyBonus(T& entry, const int bonus)
+{
+    entry += (T)(bonus - entry * std::abs(bonus) / MAX_HISTORY);
+}
+
+void updateQuietHistory(const int move, const int bonus)
+{
+    int piece = Move::getPiece(move), target = Move::getTarget(move);
+    applyBonus(historyMoves[piece][target], bonus);
+    for (int back = 1; back <= 2 && ply - back >= 0; back++) {
+        if (ContHistEntry* contHist = searchStack[ply - back].contHist)
+            applyBonus((*contHist)[piece][target], bonus);
+    }
+}
+
+void updateHistories(const Board& board, const int bestMove, const int depth,
+                     const std::array<int, 64>& quietsTried, const int quietCount,
+                     const std::array<int, 64>& capturesTried, const int captureCount)
+{
+    int bonus = std::min(16 * depth * depth, 1200);
+
+    if (Move::isCapture(bestMove)) {
+        applyBonus(captureHistory[Move::getPiece(bestMove)][Move::getTarget(bestMove)]
+                                 [getCapturedType(board, bestMove)],
+                   bonus);
+    } else if (Move::getPromoted(bestMove) == (int)Piece::E) {
+        std::array<int, 2>& killers = searchStack[ply].killers;
+        // Move 1st killer move to 2nd killer move
+        if (killers[0] != bestMove) {
+            killers[1] = killers[0];
+            // Update 1st killer move to current move
+            killers[0] = bestMove;
+        }
+        // Store counter move
+        if (ply > 0 && searchStack[ply - 1].currentMove)
+            counterMoves[Move::getPiece(searchStack[ply - 1].currentMove)]
+                        [Move::getTarget(searchStack[ply - 1].currentMove)] = bestMove;
+
+        updateQuietHistory(bestMove, bonus);
+        // Penalize the quiet moves that were searched before it
+        for (int i = 0; i < quietCount; i++)
+            updateQuietHistory(quietsTried[i], -bonus);
     }
+    // Captures that were searched before the best move didn't cause a cutoff either
+    for (int i = 0; i < captureCount; i++)
+        applyBonus(captureHistory[Move::getPiece(capturesTried[i])]
+                                 [Move::getTarget(capturesTried[i])]
+                                 [getCapturedType(board, capturesTried[i])],
+                   -bonus);
 }
 
 void enablePVScoring(Move::MoveList& moveList)
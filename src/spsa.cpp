@@ -0,0 +1,108 @@
+#include "spsa.hpp"
+
+#include "match.hpp"
+#include "misc.hpp"
+#include "tunable.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace Spsa
+{
+
+// Decay exponents of the step sizes and of the perturbations
+const double ALPHA = 0.602;
+const double GAMMA = 0.101;
+
+void run(const Params& params)
+{
+    std::vector<Tunable::Param*> tuned;
+    if (params.names.empty()) {
+        for (Tunable::Param& param : Tunable::registry())
+            tuned.push_back(&param);
+    }
+    for (const std::string& name : params.names) {
+        Tunable::Param* param = Tunable::find(name);
+        if (!param) {
+            std::cout << "Unknown parameter " << name << "\n";
+            return;
+        }
+        tuned.push_back(param);
+    }
+    if (tuned.empty()) {
+        std::cout << "No tunable parameters; this binary was built with NO_TUNABLE_PARAMS\n";
+        return;
+    }
+
+    std::vector<double> theta;
+    for (const Tunable::Param* param : tuned)
+        theta.push_back(*param->value);
+    const int iterations = std::max(params.iterations, 1);
+    // Stability constant, to keep the first steps small
+    const double a = 0.1 * iterations;
+    std::mt19937 rng((uint32_t)Time::now());
+
+    Match::Params match;
+    match.openingsFile = params.openingsFile;
+    match.games = 2 * std::max(params.pairs, 1);
+    match.concurrency = params.concurrency;
+    match.baseTime = params.baseTime;
+    match.increment = params.increment;
+    match.nodes = params.nodes;
+    match.verbose = false;
+    for (Match::EngineConfig& engine : match.engines)
+        engine.command = params.engineCommand;
+
+    Match::Results total;
+    for (int k = 1; k <= iterations; k++) {
+        // Perturbation and step size of every parameter; both shrink to 'step' and
+        // 'learningRate * step^2' at the end of the run
+        std::vector<double> c(tuned.size()), r(tuned.size());
+        std::vector<int> delta(tuned.size());
+        for (size_t i = 0; i < tuned.size(); i++) {
+            c[i] = tuned[i]->step * std::pow((double)iterations / k, GAMMA);
+            double stepSize = params.learningRate * tuned[i]->step * tuned[i]->step *
+                              std::pow((a + iterations) / (a + k), ALPHA);
+            r[i] = stepSize / (c[i] * c[i]);
+            delta[i] = rng() & 1 ? 1 : -1;
+        }
+        for (int side = 0; side < 2; side++) {
+            match.engines[side].options.clear();
+            for (size_t i = 0; i < tuned.size(); i++) {
+                double value = theta[i] + (side == 0 ? 1 : -1) * c[i] * delta[i];
+                int rounded = std::clamp((int)std::lround(value), tuned[i]->min, tuned[i]->max);
+                match.engines[side].options.emplace_back(tuned[i]->name, std::to_string(rounded));
+            }
+        }
+        match.openingOffset = (k - 1) * std::max(params.pairs, 1);
+
+        Match::Results results = Match::run(match);
+        if (results.games() == 0)
+            return;
+        total.wins += results.wins;
+        total.losses += results.losses;
+        total.draws += results.draws;
+        // Points gained by the positive perturbation over the negative one
+        int gain = results.wins - results.losses;
+        for (size_t i = 0; i < tuned.size(); i++)
+            theta[i] = std::clamp(theta[i] + r[i] * c[i] * gain * delta[i],
+                                  (double)tuned[i]->min, (double)tuned[i]->max);
+
+        std::cout << "Iteration " << k << "/" << iterations << " " << results.wins << "-"
+                  << results.losses << "-" << results.draws << " total " << total.wins << "-"
+                  << total.losses << "-" << total.draws << std::fixed << std::setprecision(2);
+        for (size_t i = 0; i < tuned.size(); i++)
+            std::cout << " " << tuned[i]->name << "=" << theta[i];
+        std::cout << std::defaultfloat << "\n";
+    }
+
+    std::cout << "Final values:\n";
+    for (size_t i = 0; i < tuned.size(); i++)
+        std::cout << "setoption name " << tuned[i]->name << " value " << std::lround(theta[i])
+                  << "\n";
+}
+
+} // namespace Spsa
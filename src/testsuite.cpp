@@ -0,0 +1,108 @@
+#include "testsuite.hpp"
+
+#include "board.hpp"
+#include "misc.hpp"
+#include "move.hpp"
+#include "packed.hpp"
+#include "search.hpp"
+#include "tt.hpp"
+#include "uci.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace TestSuite
+{
+
+// Moves of a 'bm' or 'am' operand, which may list several separated by spaces
+std::vector<int> parseMoves(const std::string& operand, const Board& board)
+{
+    std::vector<int> moves;
+    std::istringstream stream(operand);
+    std::string san;
+    while (stream >> san)
+        if (int move = Move::parseSan(san, board))
+            moves.push_back(move);
+    return moves;
+}
+
+void run(const Params& params)
+{
+    std::ifstream file(params.file);
+    if (!file) {
+        std::cout << "Could not open " << params.file << "\n";
+        return;
+    }
+
+    int total = 0;
+    uint64_t totalNodes = 0;
+    // Time and nodes to solution of the solved positions
+    std::vector<int64_t> solveTimes;
+    std::vector<uint64_t> solveNodes;
+    std::string line;
+    while (std::getline(file, line)) {
+        Board board;
+        int score;
+        Packed::Result result;
+        if (line.empty() || !Packed::parseLine(line, board, score, result))
+            continue;
+        std::vector<int> best = parseMoves(Packed::operation(line, "bm"), board);
+        std::vector<int> avoid = parseMoves(Packed::operation(line, "am"), board);
+        if (best.empty() && avoid.empty())
+            continue;
+        std::string id = Packed::operation(line, "id");
+        total++;
+
+        // Every position starts from a clean state so results do not depend on the order
+        TT::clearTTtable();
+        Search::clearKeyHistory();
+        UCI::isTimeControlled = true;
+        UCI::stopTime = Time::now() + params.moveTime;
+        Search::SearchResult searchResult = Search::position(board, Search::MAX_PLY, false);
+        UCI::isTimeControlled = false;
+        totalNodes += Search::nodes;
+
+        int move = searchResult.bestMove;
+        bool solved = (best.empty() || std::find(best.begin(), best.end(), move) != best.end()) &&
+                      std::find(avoid.begin(), avoid.end(), move) == avoid.end();
+        if (solved) {
+            solveTimes.push_back(searchResult.bestMoveTime);
+            solveNodes.push_back(searchResult.bestMoveNodes);
+        }
+        std::cout << (solved ? "solved " : "failed ") << (id.empty() ? std::to_string(total) : id)
+                  << " " << Move::toSan(move, board) << " depth " << searchResult.depth;
+        if (solved)
+            std::cout << " time " << searchResult.bestMoveTime << " nodes "
+                      << searchResult.bestMoveNodes;
+        std::cout << "\n";
+    }
+
+    size_t solved = solveTimes.size();
+    std::cout << "Solved " << solved << "/" << total << " at " << params.moveTime
+              << " ms per position, total nodes " << totalNodes << "\n";
+    if (!solved)
+        return;
+    int64_t timeSum = 0;
+    uint64_t nodeSum = 0;
+    for (size_t i = 0; i < solved; i++) {
+        timeSum += solveTimes[i];
+        nodeSum += solveNodes[i];
+    }
+    std::sort(solveTimes.begin(), solveTimes.end());
+    std::sort(solveNodes.begin(), solveNodes.end());
+    // Medians of an even count are the mean of the two middle values
+    auto median = [solved](const auto& values) {
+        return solved % 2 ? (double)values[solved / 2]
+                          : (values[solved / 2 - 1] + values[solved / 2]) / 2.0;
+    };
+    std::cout << std::fixed << std::setprecision(1) << "Time to solution: mean "
+              << (double)timeSum / solved << " ms median " << median(solveTimes) << " ms\n"
+              << "Nodes to solution: mean " << (double)nodeSum / solved << " median "
+              << median(solveNodes) << std::defaultfloat << "\n";
+}
+
+} // namespace TestSuite
@@ -2,6 +2,8 @@
 
 #include "search.hpp"
 
+#include <algorithm>
+
 namespace TT {
 const int F_HASH_EXACT = 0;
 const int F_HASH_ALPHA = 1;
@@ -9,40 +11,51 @@ const int F_HASH_BETA = 2;
 
 const int NO_ENTRY = 100'000;
 
-constexpr const int PER_MB = 1'000'000 / sizeof(TTEntry);
 constexpr int hashSize = 50 * PER_MB;
-std::array<TTEntry, hashSize> ttTable;
-
-void clearTTtable() { ttTable.fill(TTEntry()); }
-
-int readEntry(const Board& board, const int alpha, const int beta, const int depth) {
-    TTEntry entry = ttTable[(board.state.posKey * board.state.posLock) % hashSize];
-    if (entry.hashKey == board.state.posKey && entry.hashLock == board.state.posLock) {
-        // Extract score from hash entry
-        // Or extract mate distance from actual position
-        if (entry.score < -Search::MATE_SCORE)
-            entry.score += Search::ply;
-        if (entry.score > Search::MATE_SCORE)
-            entry.score -= Search::ply;
-
-        // Check if depth is the same
-        if (entry.depth >= depth) {
-            // Match EXACT (PV node) score
-            if (entry.flag == F_EXACT)
-                return entry.score;
-            // Match ALPHA (fail-low node) score
-            if ((entry.flag == F_ALPHA) && (entry.score <= alpha))
-                return alpha;
-            // Match BETA (fail-high node) score
-            if ((entry.flag == F_BETA) && (entry.score >= beta))
-                return beta;
-        }
+Table mainTable(hashSize);
+// Table searched by the calling thread; the UCI searches share the main one
+thread_local Table* ttTable = &mainTable;
+
+void clearTTtable() { std::fill(mainTable.begin(), mainTable.end(), TTEntry()); }
+
+void useTable(Table* table) { ttTable = table ? table : &mainTable; }
+
+bool probeEntry(const Board& board, TTEntry& entry) {
+    entry = (*ttTable)[(board.state.posKey * board.state.posLock) % ttTable->size()];
+    if (entry.hashKey != board.state.posKey || entry.hashLock != board.state.posLock)
+        return false;
+
+    // Extract score from hash entry
+    // Or extract mate distance from actual position
+    if (entry.score < -Search::MATE_SCORE)
+        entry.score += Search::ply;
+    if (entry.score > Search::MATE_SCORE)
+        entry.score -= Search::ply;
+    return true;
+}
+
+int readEntry(const TTEntry& entry, const int alpha, const int beta, const int depth) {
+    // Check if depth is the same
+    if (entry.depth >= depth) {
+        // Match EXACT (PV node) score
+        if (entry.flag == F_EXACT)
+            return entry.score;
+        // Match ALPHA (fail-low node) score
+        if ((entry.flag == F_ALPHA) && (entry.score <= alpha))
+            return alpha;
+        // Match BETA (fail-high node) score
+        if ((entry.flag == F_BETA) && (entry.score >= beta))
+            return beta;
     }
     return NO_ENTRY;
 }
 
-void writeEntry(const Board& board, const int depth, int score, const int flag) {
-    uint64_t index = (board.state.posKey * board.state.posLock) % hashSize;
+void writeEntry(const Board& board, const int depth, int score, const int flag, const int move) {
+    TTEntry& slot = (*ttTable)[(board.state.posKey * board.state.posLock) % ttTable->size()];
+    bool samePosition = slot.hashKey == board.state.posKey && slot.hashLock == board.state.posLock;
+    // Don't let shallow (e.g. quiescence) results replace a deeper search of the same position
+    if (samePosition && flag != F_EXACT && depth + 2 < slot.depth)
+        return;
 
     // Store mate score independent from the actual path
     if (score < -Search::MATE_SCORE)
@@ -51,11 +64,14 @@ void writeEntry(const Board& board, const int depth, int score, const int flag)
         score += Search::ply;
 
     // Write data into TTEntry
-    ttTable[index].hashKey = board.state.posKey;
-    ttTable[index].hashLock = board.state.posLock;
-    ttTable[index].score = score;
-    ttTable[index].depth = depth;
-    ttTable[index].flag = flag;
+    slot.hashKey = board.state.posKey;
+    slot.hashLock = board.state.posLock;
+    slot.score = score;
+    slot.depth = depth;
+    slot.flag = flag;
+    // Keep the previous best move of the position if this search didn't find one
+    if (move || !samePosition)
+        slot.move = move;
 }
 
 } // namespace TT
\ No newline at end of file
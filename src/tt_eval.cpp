@@ -4,16 +4,40 @@
 #include "tt.hpp"
 #include "zobrist.hpp"
 
+#include <algorithm>
+#include <vector>
+
 namespace TT::Eval {
 
-// Pawn Evaluation table
+const int DEFAULT_EVAL_HASH_MB = 2;
+const int MAX_EVAL_HASH_MB = 1024;
+
+// Full static evaluations, keyed by position key
+// Kept apart from the main transposition table so the two never compete for slots
 constexpr const int PER_MB = 1'000'000 / sizeof(EvalEntry);
-constexpr const int pawnTableSize = 2 * PER_MB;
-std::array<EvalEntry, pawnTableSize> pawnTable;
+std::vector<EvalEntry> evalTable(DEFAULT_EVAL_HASH_MB * PER_MB);
+
+void resize(const int megabytes) {
+    evalTable.assign((size_t)std::clamp(megabytes, 1, MAX_EVAL_HASH_MB) * PER_MB, EvalEntry());
+}
+
+void clearEvalTable() { std::fill(evalTable.begin(), evalTable.end(), EvalEntry()); }
+
+inline uint64_t toCheck(const uint64_t key, const int eval) {
+    return key ^ (uint64_t)(uint32_t)eval;
+}
 
-void clearEvalTable() { pawnTable.fill(EvalEntry()); }
+int readEntry(const Board& board) {
+    const EvalEntry entry = evalTable[board.state.posKey % evalTable.size()];
+    if (toCheck(board.state.posKey, entry.eval) != entry.check)
+        return TT::NO_ENTRY;
+    return entry.eval;
+}
 
-int readEntry(const Board &board) { return TT::NO_ENTRY; }
-void writeEntry(const Board &board, int eval) {}
+void writeEntry(const Board& board, int eval) {
+    EvalEntry& entry = evalTable[board.state.posKey % evalTable.size()];
+    entry.eval = eval;
+    entry.check = toCheck(board.state.posKey, eval);
+}
 
-} // namespace TT::Eval
\ No newline at end of file
+} // namespace TT::Eval
@@ -0,0 +1,26 @@
+#include "tunable.hpp"
+
+namespace Tunable
+{
+
+std::vector<Param>& registry()
+{
+    // Constructed on first use, as parameters register themselves during static initialization
+    static std::vector<Param> params;
+    return params;
+}
+
+Param* find(const std::string& name)
+{
+    for (Param& param : registry())
+        if (param.name == name)
+            return &param;
+    return nullptr;
+}
+
+Registrar::Registrar(const char* name, int* value, const int min, const int max, const int step)
+{
+    registry().push_back({name, value, *value, min, max, step});
+}
+
+} // namespace Tunable
@@ -0,0 +1,439 @@
+#include "tuner.hpp"
+
+#include "board.hpp"
+#include "eval_constants.hpp"
+#include "misc.hpp"
+#include "packed.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace Tuner
+{
+
+std::vector<Entry> entries;
+std::vector<Coefficient> coefficients;
+
+// Runs 'work(begin, end, thread)' over 'n' items split evenly between the threads
+template <typename Work> void parallelFor(const size_t n, const int threads, Work work)
+{
+    std::vector<std::thread> pool;
+    size_t chunk = (n + threads - 1) / threads;
+    for (int t = 0; t < threads; t++) {
+        size_t begin = std::min(n, t * chunk), end = std::min(n, begin + chunk);
+        pool.emplace_back(work, begin, end, t);
+    }
+    for (std::thread& thread : pool)
+        thread.join();
+}
+
+Weights currentWeights()
+{
+    Weights weights{};
+    for (int term = 0; term < Eval::Terms::COUNT; term++) {
+        Score score = Eval::termScore(term);
+        weights[term] = {(double)mgValue(score), (double)egValue(score)};
+    }
+    return weights;
+}
+
+// Result of a game as white's expected score
+float toScore(const Packed::Result result) { return (int)result / 2.0f; }
+
+// Evaluation of a traced position from white's point of view
+double evaluate(const Entry& entry, const Coefficient* coeff, const Weights& weights)
+{
+    double mg = entry.dangerMg, eg = entry.dangerEg;
+    for (int i = 0; i < entry.count; i++) {
+        mg += coeff[i].count * weights[coeff[i].term][0];
+        eg += coeff[i].count * weights[coeff[i].term][1];
+    }
+    eg = eg * entry.scale[eg > 0 ? 0 : 1] / Material::SCALE_NORMAL;
+    return (mg * (256 - entry.phase) + eg * entry.phase) / 256;
+}
+
+// Traces positions 'begin' to 'end' into 'out' and 'outCoeffs'; 'read' sets up a position and
+// its result, or returns false to skip it. Returns the summed difference between the traced and
+// the real evaluations.
+double tracePositions(const std::function<bool(size_t, Board&, float&)>& read, const size_t begin,
+                      const size_t end, std::vector<Entry>& out,
+                      std::vector<Coefficient>& outCoeffs)
+{
+    double traceError = 0.0;
+    const Weights weights = currentWeights();
+    Eval::EvalTrace trace;
+    Board board;
+    for (size_t i = begin; i < end; i++) {
+        Entry entry{};
+        if (!read(i, board, entry.result))
+            continue;
+        int eval = Eval::traceEval(board, trace);
+        if (!trace.complete)
+            continue;
+
+        entry.begin = (uint32_t)outCoeffs.size();
+        for (int term = 0; term < Eval::Terms::COUNT; term++) {
+            int count =
+                trace.coeffs[term][(int)Color::WHITE] - trace.coeffs[term][(int)Color::BLACK];
+            if (count != 0)
+                outCoeffs.push_back({(uint16_t)term, (int16_t)count});
+        }
+        entry.count = (uint16_t)(outCoeffs.size() - entry.begin);
+        entry.phase = trace.phase;
+        entry.scale = trace.scale;
+        Score danger = trace.danger[(int)Color::WHITE] - trace.danger[(int)Color::BLACK];
+        entry.dangerMg = (int16_t)mgValue(danger);
+        entry.dangerEg = (int16_t)egValue(danger);
+        out.push_back(entry);
+
+        double linear = evaluate(entry, outCoeffs.data() + entry.begin, weights);
+        traceError += std::abs(linear - (board.state.side == Color::WHITE ? eval : -eval));
+    }
+    return traceError;
+}
+
+// Packed files (.bin) are read straight from the mapping; anything else is parsed as text with
+// one position per line
+bool load(const std::string& path, const int threads)
+{
+    Packed::Reader reader;
+    std::vector<std::string> lines;
+    std::function<bool(size_t, Board&, float&)> read;
+    size_t total;
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".bin") == 0) {
+        if (!reader.open(path)) {
+            std::cout << "Could not open " << path << "\n";
+            return false;
+        }
+        total = reader.count;
+        read = [&](size_t i, Board& board, float& result) {
+            if (reader[i].result == Packed::Result::UNKNOWN)
+                return false;
+            Packed::unpack(reader[i], board);
+            result = toScore(reader[i].result);
+            return true;
+        };
+    } else {
+        std::ifstream file(path);
+        if (!file) {
+            std::cout << "Could not open " << path << "\n";
+            return false;
+        }
+        std::string line;
+        while (std::getline(file, line))
+            if (!line.empty())
+                lines.push_back(line);
+        total = lines.size();
+        read = [&](size_t i, Board& board, float& result) {
+            int score;
+            Packed::Result packedResult;
+            if (!Packed::parseLine(lines[i], board, score, packedResult) ||
+                packedResult == Packed::Result::UNKNOWN)
+                return false;
+            result = toScore(packedResult);
+            return true;
+        };
+    }
+
+    std::vector<std::vector<Entry>> threadEntries(threads);
+    std::vector<std::vector<Coefficient>> threadCoeffs(threads);
+    std::vector<double> traceErrors(threads, 0.0);
+    parallelFor(total, threads, [&](size_t begin, size_t end, int t) {
+        traceErrors[t] = tracePositions(read, begin, end, threadEntries[t], threadCoeffs[t]);
+    });
+
+    entries.clear();
+    coefficients.clear();
+    double traceError = 0.0;
+    for (int t = 0; t < threads; t++) {
+        uint32_t offset = (uint32_t)coefficients.size();
+        for (Entry& entry : threadEntries[t]) {
+            entry.begin += offset;
+            entries.push_back(entry);
+        }
+        coefficients.insert(coefficients.end(), threadCoeffs[t].begin(), threadCoeffs[t].end());
+        traceError += traceErrors[t];
+    }
+    std::cout << "Loaded " << entries.size() << " of " << total << " positions, "
+              << coefficients.size() << " coefficients\n";
+    if (!entries.empty())
+        std::cout << "Average difference between the traced and the real evaluation: "
+                  << traceError / entries.size() << "\n";
+    return !entries.empty();
+}
+
+double evaluate(const Entry& entry, const Weights& weights)
+{
+    return evaluate(entry, coefficients.data() + entry.begin, weights);
+}
+
+// Expected score of white for an evaluation
+inline double sigmoid(const double eval, const double k)
+{
+    return 1.0 / (1.0 + std::pow(10.0, -k * eval / 400.0));
+}
+
+double totalError(const Weights& weights, const double k, const int threads)
+{
+    std::vector<double> errors(threads, 0.0);
+    parallelFor(entries.size(), threads, [&](size_t begin, size_t end, int t) {
+        double error = 0.0;
+        for (size_t i = begin; i < end; i++) {
+            double diff = entries[i].result - sigmoid(evaluate(entries[i], weights), k);
+            error += diff * diff;
+        }
+        errors[t] = error;
+    });
+    double error = 0.0;
+    for (double e : errors)
+        error += e;
+    return error / entries.size();
+}
+
+// Scaling of the evaluation that best fits the results, with the current weights
+double computeK(const Weights& weights, const int threads)
+{
+    double best = 1.0, step = 0.1;
+    for (int pass = 0; pass < 3; pass++) {
+        double start = std::max(0.0, best - 10 * step);
+        double bestError = totalError(weights, best, threads);
+        for (double k = start; k <= best + 10 * step; k += step) {
+            double error = totalError(weights, k, threads);
+            if (error < bestError) {
+                bestError = error;
+                best = k;
+            }
+        }
+        step /= 10;
+    }
+    return best;
+}
+
+// Gradient of the error with respect to every weight, up to a constant factor that Adam ignores
+void computeGradient(const Weights& weights, const double k, const int threads, Weights& gradient)
+{
+    std::vector<Weights> partial(threads);
+    parallelFor(entries.size(), threads, [&](size_t begin, size_t end, int t) {
+        Weights& grad = partial[t];
+        grad = Weights{};
+        for (size_t i = begin; i < end; i++) {
+            const Entry& entry = entries[i];
+            double mg = entry.dangerMg, eg = entry.dangerEg;
+            const Coefficient* coeff = coefficients.data() + entry.begin;
+            for (int c = 0; c < entry.count; c++) {
+                mg += coeff[c].count * weights[coeff[c].term][0];
+                eg += coeff[c].count * weights[coeff[c].term][1];
+            }
+            double egScale = (double)entry.scale[eg > 0 ? 0 : 1] / Material::SCALE_NORMAL;
+            double eval = (mg * (256 - entry.phase) + eg * egScale * entry.phase) / 256;
+            double s = sigmoid(eval, k);
+            double g = (s - entry.result) * s * (1.0 - s);
+            double mgFactor = g * (256 - entry.phase) / 256;
+            double egFactor = g * entry.phase * egScale / 256;
+            for (int c = 0; c < entry.count; c++) {
+                grad[coeff[c].term][0] += coeff[c].count * mgFactor;
+                grad[coeff[c].term][1] += coeff[c].count * egFactor;
+            }
+        }
+    });
+    gradient = Weights{};
+    for (const Weights& grad : partial)
+        for (int term = 0; term < Eval::Terms::COUNT; term++)
+            for (int phase = 0; phase < 2; phase++)
+                gradient[term][phase] += grad[term][phase];
+}
+
+void run(const Params& params)
+{
+    int threads = std::max(params.threads, 1);
+    int64_t startTime = Time::now();
+    if (!load(params.dataFile, threads))
+        return;
+    std::cout << "Traced in " << Time::now() - startTime << " ms\n";
+
+    Weights weights = currentWeights();
+    double k = computeK(weights, threads);
+    std::cout << "K = " << k << ", initial error " << std::setprecision(8)
+              << totalError(weights, k, threads) << "\n";
+
+    // Adam
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    Weights m{}, v{}, gradient{};
+    startTime = Time::now();
+    for (int epoch = 1; epoch <= params.epochs; epoch++) {
+        computeGradient(weights, k, threads, gradient);
+        double correction1 = 1.0 - std::pow(beta1, epoch);
+        double correction2 = 1.0 - std::pow(beta2, epoch);
+        for (int term = 0; term < Eval::Terms::COUNT; term++) {
+            for (int phase = 0; phase < 2; phase++) {
+                double g = gradient[term][phase];
+                m[term][phase] = beta1 * m[term][phase] + (1 - beta1) * g;
+                v[term][phase] = beta2 * v[term][phase] + (1 - beta2) * g * g;
+                weights[term][phase] -= params.learningRate * (m[term][phase] / correction1) /
+                                        (std::sqrt(v[term][phase] / correction2) + epsilon);
+            }
+        }
+
+        if (epoch % 10 == 0 || epoch == params.epochs) {
+            std::cout << "Epoch " << epoch << " error " << totalError(weights, k, threads)
+                      << " time " << Time::now() - startTime << " ms\n";
+        }
+        if (epoch % 100 == 0 || epoch == params.epochs)
+            writeConstants(params.outputFile, weights);
+    }
+    std::cout << "Wrote " << params.outputFile << "\n";
+}
+
+std::string score(const Weights& weights, const int term)
+{
+    return "S(" + std::to_string(std::lround(weights[term][0])) + ", " +
+           std::to_string(std::lround(weights[term][1])) + ")";
+}
+
+void writeScores(std::ostream& out, const Weights& weights, const int first, const int count,
+                 const int perLine)
+{
+    for (int i = 0; i < count; i++) {
+        out << (i % perLine == 0 ? "    " : " ") << score(weights, first + i) << ",";
+        if (i % perLine == perLine - 1 || i == count - 1)
+            out << "\n";
+    }
+}
+
+template <typename T, size_t N> std::string list(const std::array<T, N>& values)
+{
+    std::string str;
+    for (size_t i = 0; i < N; i++)
+        str += (i ? ", " : "") + std::to_string((int)values[i]);
+    return str;
+}
+
+void writePSQT(std::ostream& out, const Weights& weights, const int phase, const std::string& name)
+{
+    static const std::array<std::string, 6> pieceNames = {"Pawn", "Knight", "Bishop",
+                                                          "Rook", "Queen",  "King"};
+    out << "constexpr std::array<std::array<int16_t, 64>, 6> PSQT_" << name << " = {{\n";
+    for (int type = 0; type < 6; type++) {
+        out << "    {\n        // " << name << " " << pieceNames[type] << " PST\n";
+        for (int rank = 0; rank < 8; rank++) {
+            out << "        ";
+            for (int file = 0; file < 8; file++)
+                out << std::setw(4)
+                    << std::lround(weights[Eval::Terms::PSQT + type * 64 + rank * 8 + file][phase])
+                    << ",";
+            out << "\n";
+        }
+        out << "    },\n";
+    }
+    out << "}};\n\n";
+}
+
+// Writes a replacement for eval_constants.cpp with the tuned weights and the untuned constants
+void writeConstants(const std::string& path, const Weights& weights)
+{
+    using namespace Eval;
+    using namespace Eval::Terms;
+    std::ofstream out(path);
+    out << "#include \"eval_constants.hpp\"\n\nnamespace Eval\n{\n\n";
+    out << "constexpr std::array<std::array<int16_t, 6>, 2> PIECE_VALUES = {\n    {{";
+    for (int phase = 0; phase < 2; phase++) {
+        for (int type = 0; type < 5; type++)
+            out << (type ? ", " : "") << std::lround(weights[PIECE_VALUE + type][phase]);
+        out << (phase == 0 ? "}, {" : "}}};\n");
+    }
+    out << "const std::array<Score, 5> PIECE_MOBILITY = {";
+    for (int type = 0; type < 5; type++)
+        out << (type ? ", " : "") << score(weights, MOBILITY + type);
+    out << "};\n\n";
+
+    out << "const int8_t DRAW_SCORE = " << (int)DRAW_SCORE << ";\n\n";
+    out << "const int16_t PAWN_PHASE = " << PAWN_PHASE << ";\n";
+    out << "const int16_t KNIGHT_PHASE = " << KNIGHT_PHASE << ";\n";
+    out << "const int16_t BISHOP_PHASE = " << BISHOP_PHASE << ";\n";
+    out << "const int16_t ROOK_PHASE = " << ROOK_PHASE << ";\n";
+    out << "const int16_t QUEEN_PHASE = " << QUEEN_PHASE << ";\n";
+    out << "const int16_t TOTAL_PHASE = (PAWN_PHASE * 16) + (KNIGHT_PHASE * 4) + (BISHOP_PHASE * "
+           "4) +\n                                      (ROOK_PHASE * 4) + (QUEEN_PHASE * 2);\n\n";
+    out << "const std::array<int8_t, 6> PHASE_VALUES = {PAWN_PHASE, KNIGHT_PHASE, BISHOP_PHASE, "
+           "ROOK_PHASE,\n                                            QUEEN_PHASE, 0};\n\n";
+
+    out << "// Penalties\n";
+    out << "const Score ISOLATED_PAWN_PENALTY = " << score(weights, ISOLATED_PAWN) << ";\n";
+    out << "const Score DOUBLED_PAWN_PENALTY = " << score(weights, DOUBLED_PAWN) << ";\n\n";
+    out << "// Bonuses\n";
+    out << "const Score BISHOP_PAIR_BONUS = " << score(weights, BISHOP_PAIR) << ";\n";
+    out << "const Score KNIGHT_OUTPOST_BONUS = " << score(weights, KNIGHT_OUTPOST) << ";\n";
+    out << "const Score BISHOP_OUTPOUT_BONUS = " << score(weights, BISHOP_OUTPOST) << ";\n";
+    out << "const Score ROOK_OR_QUEEN_ON_SEVENTH_BONUS = "
+        << score(weights, ROOK_OR_QUEEN_ON_SEVENTH) << ";\n";
+    out << "const Score ROOK_ON_OPEN_FILE_BONUS = " << score(weights, ROOK_ON_OPEN_FILE) << ";\n";
+    out << "const Score TEMPO_BONUS = " << score(weights, TEMPO) << ";\n";
+    out << "const Score THREAT_BY_PAWN = " << score(weights, Terms::THREAT_BY_PAWN) << ";\n\n";
+
+    out << "// King safety\n";
+    out << "// Danger per king zone square attacked, by piece type\n";
+    out << "const std::array<int8_t, 5> KING_ATTACK_WEIGHTS = {" << list(KING_ATTACK_WEIGHTS)
+        << "};\n";
+    out << "// Percentage of the attack danger that counts, by number of attackers\n";
+    out << "const std::array<int8_t, 8> ATTACKER_COUNT_SCALE = {" << list(ATTACKER_COUNT_SCALE)
+        << "};\n";
+    out << "// Danger of a check the enemy can give without losing the checking piece, by piece "
+           "type\n";
+    out << "const std::array<int8_t, 5> SAFE_CHECK_WEIGHTS = {" << list(SAFE_CHECK_WEIGHTS)
+        << "};\n";
+    out << "// Danger per square next to the king that is attacked and only defended by the king\n";
+    out << "const int8_t WEAK_KING_SQUARE_WEIGHT = " << (int)WEAK_KING_SQUARE_WEIGHT << ";\n";
+    out << "// By distance from the king to the closest pawn in front of it, on the king file or "
+           "next to it\n";
+    out << "const std::array<Score, 8> PAWN_SHIELD_BONUS = {\n";
+    writeScores(out, weights, PAWN_SHIELD, 8, 4);
+    out << "};\nconst std::array<Score, 8> PAWN_STORM_PENALTY = {\n";
+    writeScores(out, weights, PAWN_STORM, 8, 4);
+    out << "};\n";
+    out << "// Files next to the king without friendly pawns, with and without enemy pawns\n";
+    out << "const Score KING_OPEN_FILE_PENALTY = " << score(weights, KING_OPEN_FILE) << ";\n";
+    out << "const Score KING_SEMI_OPEN_FILE_PENALTY = " << score(weights, KING_SEMI_OPEN_FILE)
+        << ";\n\n";
+
+    out << "// Imbalance, per own pawn above five\n";
+    out << "const Score KNIGHT_PAWN_ADJUSTMENT = " << score(weights, Terms::KNIGHT_PAWN_ADJUSTMENT)
+        << ";\n";
+    out << "const Score ROOK_PAWN_ADJUSTMENT = " << score(weights, Terms::ROOK_PAWN_ADJUSTMENT)
+        << ";\n\n";
+
+    writePSQT(out, weights, 0, "MG");
+    writePSQT(out, weights, 1, "EG");
+
+    out << "const std::array<Score, 64> PASSED_PAWN_PSQT = {\n";
+    writeScores(out, weights, PASSED_PAWN, 64, 8);
+    out << "};\n\n";
+
+    out << R"(// Fused at compile time so that boards constructed during static initialization can use it
+constexpr std::array<std::array<Score, 64>, 12> fusePSQ()
+{
+    std::array<std::array<Score, 64>, 12> table{};
+    for (int piece = (int)Piece::P; piece <= (int)Piece::k; piece++) {
+        int type = COLORLESS(piece);
+        for (int sq = 0; sq < 64; sq++) {
+            // The tables are laid out from white's point of view
+            int tableSq = piece < (int)Piece::p ? sq : FLIP(sq);
+            table[piece][sq] = S(PIECE_VALUES[(int)Phase::MG][type] + PSQT_MG[type][tableSq],
+                                 PIECE_VALUES[(int)Phase::EG][type] + PSQT_EG[type][tableSq]);
+        }
+    }
+    return table;
+}
+
+constexpr std::array<std::array<Score, 64>, 12> psq = fusePSQ();
+
+} // namespace Eval
+)";
+}
+
+} // namespace Tuner
@@ -1,10 +1,29 @@
 #include "uci.hpp"
 
+#include "analyse.hpp"
+#include "bench.hpp"
 #include "board.hpp"
+#include "datagen.hpp"
+#include "eval.hpp"
+#include "match.hpp"
 #include "misc.hpp"
 #include "move.hpp"
+#include "nnue.hpp"
+#include "packed.hpp"
 #include "perft.hpp"
 #include "search.hpp"
+#include "spsa.hpp"
+#include "testsuite.hpp"
+#include "tt_eval.hpp"
+#include "tunable.hpp"
+#include "tuner.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -14,25 +33,72 @@ namespace UCI {
 
 Board mainBoard;
 bool quit = false;
-bool stop = false;
+// Limits of the search running on the calling thread
+thread_local bool stop = false;
 bool isInfinite = false;
-bool isTimeControlled = false;
+thread_local bool isTimeControlled = false;
+thread_local uint64_t nodeLimit = 0;
 
 int timeLeft = -1;
 int increment = 0;
 int movesToGo = 40;
 int moveTime = -1;
 int64_t startTime = 0L;
-int64_t stopTime = 0L;
+thread_local int64_t stopTime = 0L;
+// Searches started by "go" read the input while they run
+thread_local bool listening = false;
+// Searching the position after the expected reply during the opponent's time; the time
+// budget only starts on "ponderhit"
+bool pondering = false;
+int64_t ponderBudget = 0L;
+
+// Input is read on its own thread, so commands can reach a search running on this one
+std::mutex inputMutex;
+std::condition_variable inputReady;
+std::deque<std::string> inputLines;
+bool inputClosed = false;
+// Commands that came in during a search and are run after it
+std::deque<std::string> deferredCommands;
+
+void readInput() {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        inputLines.push_back(line);
+        inputReady.notify_one();
+    }
+    std::lock_guard<std::mutex> lock(inputMutex);
+    inputClosed = true;
+    inputReady.notify_one();
+}
+
+// Takes the next line of input, waiting for one if 'wait' is set; false if there is none
+bool nextLine(std::string& line, const bool wait) {
+    std::unique_lock<std::mutex> lock(inputMutex);
+    if (wait)
+        inputReady.wait(lock, []() { return !inputLines.empty() || inputClosed; });
+    if (inputLines.empty())
+        return false;
+    line = std::move(inputLines.front());
+    inputLines.pop_front();
+    return true;
+}
 
 void loop() {
     printEngineInfo();
+    std::thread(readInput).detach();
 
     std::string input;
     while (!quit) {
         input = "";
-        // Get input
-        std::getline(std::cin, input);
+        // Output is block buffered when it goes to a pipe; send it before waiting for input
+        fflush(stdout);
+        // Get input; stop once the input is closed
+        if (!deferredCommands.empty()) {
+            input = std::move(deferredCommands.front());
+            deferredCommands.pop_front();
+        } else if (!nextLine(input, true))
+            break;
         // If input is null, continue
         if (input.empty())
             continue;
@@ -49,8 +115,11 @@ void parse(const std::string& command) {
     } else if (command.compare(0, 10, "ucinewgame") == 0)
         parsePos("position startpos");
     // uci command
-    else if (command.compare(0, 3, "uci") == 0)
+    else if (command.compare(0, 3, "uci") == 0) {
+        printOptions();
         printf("uciok\n");
+    } else if (command.compare(0, 9, "setoption") == 0)
+        parseOption(command);
     // isready command
     else if (command.compare(0, 7, "isready") == 0)
         printf("readyok\n");
@@ -62,8 +131,33 @@ void parse(const std::string& command) {
         parseGo(command);
     else if (command.compare(0, 7, "display") == 0)
         mainBoard.display();
+    else if (command == "eval")
+        Eval::printEval(mainBoard);
+    else if (command.compare(0, 10, "bench nnue") == 0)
+        Bench::nnue(command.length() > 11 ? atoi(command.substr(11).c_str()) : 50);
+    else if (command.compare(0, 10, "bench eval") == 0)
+        Bench::eval(command.length() > 11 ? atoi(command.substr(11).c_str()) : 50);
+    else if (command.compare(0, 5, "bench") == 0)
+        Bench::search(command.length() > 6 ? atoi(command.substr(6).c_str()) : 8);
+    else if (command.compare(0, 4, "tune") == 0)
+        parseTune(command);
+    else if (command.compare(0, 7, "analyse") == 0)
+        parseAnalyse(command);
+    else if (command.compare(0, 9, "testsuite") == 0)
+        parseTestsuite(command);
+    else if (command.compare(0, 4, "spsa") == 0)
+        parseSpsa(command);
+    else if (command.compare(0, 5, "match") == 0)
+        parseMatch(command);
+    else if (command.compare(0, 7, "datagen") == 0)
+        parseDatagen(command);
+    else if (command.compare(0, 7, "convert") == 0)
+        parseConvert(command);
     else if (command.compare(0, 4, "help") == 0)
         printHelpInfo();
+    // Late "ponderhit" for a search that has already been stopped
+    else if (command == "ponderhit")
+        return;
     else
         printf("Unknown command: %s\n", command.c_str());
 }
@@ -82,6 +176,7 @@ void parsePos(const std::string& command) {
         currentInd += 3 + 1;
         mainBoard = Board(command.substr(currentInd));
     }
+    Search::clearKeyHistory();
     currentInd = (int)command.find("moves", currentInd);
     if (currentInd == std::string::npos)
         return;
@@ -95,32 +190,306 @@ void parsePos(const std::string& command) {
             move = Move::parse(moveStr, mainBoard);
             if (move == 0)
                 continue;
+            Search::addGameKey(mainBoard);
             Move::make(&mainBoard, move, Move::MoveType::allMoves);
             moveStr = "";
         }
     }
 }
 
+// setoption name <name> value <value>
+void parseOption(const std::string& command) {
+    size_t nameInd = command.find("name "), valueInd = command.find(" value ");
+    if (nameInd == std::string::npos || valueInd == std::string::npos)
+        return;
+    std::string name = command.substr(nameInd + 5, valueInd - (nameInd + 5));
+    std::string value = command.substr(valueInd + 7);
+    if (name == "EvalHash")
+        TT::Eval::resize(atoi(value.c_str()));
+    else if (name == "UseNNUE") {
+        NNUE::useNNUE = value == "true";
+        if (NNUE::useNNUE && !NNUE::isLoaded)
+            printf("info string No NNUE file loaded, set EvalFile first\n");
+        // Cached evaluations come from the other evaluator
+        TT::Eval::clearEvalTable();
+    } else if (name == "EvalFile") {
+        NNUE::load(value);
+        TT::Eval::clearEvalTable();
+    } else if (name == "MultiPV")
+        Search::multiPV = std::clamp(atoi(value.c_str()), 1, Search::MAX_MULTI_PV);
+    else if (name == "Ponder") {
+        // Only tells us whether the GUI will send "go ponder"; nothing to set up
+    } else if (Tunable::Param* param = Tunable::find(name))
+        *param->value = std::clamp(atoi(value.c_str()), param->min, param->max);
+    else
+        printf("Unknown option: %s\n", name.c_str());
+}
+
+void printOptions() {
+    printf("option name EvalHash type spin default %d min 1 max %d\n",
+           TT::Eval::DEFAULT_EVAL_HASH_MB, TT::Eval::MAX_EVAL_HASH_MB);
+    printf("option name UseNNUE type check default false\n");
+    printf("option name EvalFile type string default <empty>\n");
+    printf("option name Ponder type check default false\n");
+    printf("option name MultiPV type spin default 1 min 1 max %d\n", Search::MAX_MULTI_PV);
+    for (const Tunable::Param& param : Tunable::registry())
+        printf("option name %s type spin default %d min %d max %d\n", param.name.c_str(),
+               param.defaultValue, param.min, param.max);
+}
+
+// tune <data file> [epochs <n>] [threads <n>] [lr <x>] [output <path>]
+void parseTune(const std::string& command) {
+    std::istringstream stream(command.substr(4));
+    Tuner::Params params;
+    params.threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+    stream >> params.dataFile;
+    std::string token;
+    while (stream >> token) {
+        if (token == "epochs")
+            stream >> params.epochs;
+        else if (token == "threads")
+            stream >> params.threads;
+        else if (token == "lr")
+            stream >> params.learningRate;
+        else if (token == "output")
+            stream >> params.outputFile;
+    }
+    if (params.dataFile.empty()) {
+        printf("Usage: tune <data file> [epochs <n>] [threads <n>] [lr <x>] [output <path>]\n");
+        return;
+    }
+    Tuner::run(params);
+}
+
+// match [games <n>] [concurrency <n>] [openings <file>] [tc <seconds>[+<increment>]]
+//       [nodes <n>] [sprt <elo0> <elo1> [<alpha> <beta>]]
+//       [engine1|engine2 [cmd <command>] [option <name>=<value>] ...]
+void parseMatch(const std::string& command) {
+    std::istringstream stream(command.substr(5));
+    Match::Params params;
+    std::string token;
+    // Engine the 'cmd' and 'option' tokens apply to; both by default
+    int engine = -1;
+    while (stream >> token) {
+        if (token == "games")
+            stream >> params.games;
+        else if (token == "concurrency")
+            stream >> params.concurrency;
+        else if (token == "openings")
+            stream >> params.openingsFile;
+        else if (token == "tc") {
+            std::string tc;
+            stream >> tc;
+            size_t plus = tc.find('+');
+            params.baseTime = (int)(atof(tc.c_str()) * 1000);
+            params.increment = plus == std::string::npos ? 0 : (int)(atof(&tc[plus + 1]) * 1000);
+        } else if (token == "nodes")
+            stream >> params.nodes;
+        else if (token == "sprt") {
+            params.sprt = true;
+            stream >> params.elo0 >> params.elo1;
+            // Error rates are optional
+            std::streampos pos = stream.tellg();
+            double alpha, beta;
+            if (stream >> alpha >> beta) {
+                params.alpha = alpha;
+                params.beta = beta;
+            } else {
+                stream.clear();
+                stream.seekg(pos);
+            }
+        } else if (token == "engine1" || token == "engine2")
+            engine = token == "engine1" ? 0 : 1;
+        else if (token == "cmd" || token == "option") {
+            std::string value;
+            stream >> value;
+            for (int i = 0; i < 2; i++) {
+                if (engine != -1 && engine != i)
+                    continue;
+                size_t equals = value.find('=');
+                if (token == "cmd")
+                    params.engines[i].command = value;
+                else if (equals != std::string::npos)
+                    params.engines[i].options.emplace_back(value.substr(0, equals),
+                                                           value.substr(equals + 1));
+            }
+        }
+    }
+    Match::run(params);
+}
+
+// analyse <input> <output> depth|nodes|movetime <n> [threads <n>] [hash <MB>]
+//         [format csv|json]
+void parseAnalyse(const std::string& command) {
+    std::istringstream stream(command.substr(7));
+    Analyse::Params params;
+    params.threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+    stream >> params.inputFile >> params.outputFile;
+    // JSON lines for .json and .jsonl outputs, CSV otherwise
+    size_t dot = params.outputFile.rfind('.');
+    if (dot != std::string::npos && params.outputFile.compare(dot, 5, ".json") == 0)
+        params.format = Analyse::Format::JSON;
+    std::string token;
+    bool limited = false;
+    while (stream >> token) {
+        if (token == "depth")
+            limited = (bool)(stream >> params.depth);
+        else if (token == "nodes")
+            limited = (bool)(stream >> params.nodes);
+        else if (token == "movetime")
+            limited = (bool)(stream >> params.moveTime);
+        else if (token == "threads")
+            stream >> params.threads;
+        else if (token == "hash")
+            stream >> params.hashMB;
+        else if (token == "format") {
+            stream >> token;
+            params.format = token == "json" ? Analyse::Format::JSON : Analyse::Format::CSV;
+        }
+    }
+    if (params.outputFile.empty() || !limited) {
+        printf("Usage: analyse <input> <output> depth|nodes|movetime <n> [threads <n>] "
+               "[hash <MB>] [format csv|json]\n");
+        return;
+    }
+    Analyse::run(params);
+}
+
+// testsuite <file> [movetime <ms>]
+void parseTestsuite(const std::string& command) {
+    std::istringstream stream(command.substr(9));
+    TestSuite::Params params;
+    std::string token;
+    stream >> params.file;
+    while (stream >> token)
+        if (token == "movetime")
+            stream >> params.moveTime;
+    if (params.file.empty() || params.moveTime <= 0) {
+        printf("Usage: testsuite <file> [movetime <ms>]\n");
+        return;
+    }
+    TestSuite::run(params);
+}
+
+// spsa [iterations <n>] [pairs <n>] [concurrency <n>] [openings <file>] [tc <s>[+<inc>]]
+//      [nodes <n>] [lr <x>] [cmd <command>] [params <name>,<name>,...]
+void parseSpsa(const std::string& command) {
+    std::istringstream stream(command.substr(4));
+    Spsa::Params params;
+    std::string token;
+    while (stream >> token) {
+        if (token == "iterations")
+            stream >> params.iterations;
+        else if (token == "pairs")
+            stream >> params.pairs;
+        else if (token == "concurrency")
+            stream >> params.concurrency;
+        else if (token == "openings")
+            stream >> params.openingsFile;
+        else if (token == "tc") {
+            std::string tc;
+            stream >> tc;
+            size_t plus = tc.find('+');
+            params.baseTime = (int)(atof(tc.c_str()) * 1000);
+            params.increment = plus == std::string::npos ? 0 : (int)(atof(&tc[plus + 1]) * 1000);
+        } else if (token == "nodes")
+            stream >> params.nodes;
+        else if (token == "lr")
+            stream >> params.learningRate;
+        else if (token == "cmd")
+            stream >> params.engineCommand;
+        else if (token == "params") {
+            std::string names, name;
+            stream >> names;
+            std::istringstream list(names);
+            while (std::getline(list, name, ','))
+                params.names.push_back(name);
+        }
+    }
+    Spsa::run(params);
+}
+
+// datagen <output> [positions <n>] [threads <n>] [depth <n>] [nodes <n>] [random <n>]
+//         [hash <MB>] [seed <n>]
+void parseDatagen(const std::string& command) {
+    std::istringstream stream(command.substr(7));
+    Datagen::Params params;
+    params.threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+    stream >> params.outputFile;
+    std::string token;
+    bool nodesSet = false, depthSet = false;
+    while (stream >> token) {
+        if (token == "positions")
+            stream >> params.positions;
+        else if (token == "threads")
+            stream >> params.threads;
+        else if (token == "depth")
+            depthSet = (bool)(stream >> params.depth);
+        else if (token == "nodes")
+            nodesSet = (bool)(stream >> params.nodes);
+        else if (token == "random")
+            stream >> params.randomPlies;
+        else if (token == "hash")
+            stream >> params.hashMB;
+        else if (token == "seed")
+            stream >> params.seed;
+    }
+    if (params.outputFile.empty()) {
+        printf("Usage: datagen <output> [positions <n>] [threads <n>] [depth <n>] [nodes <n>] "
+               "[random <n>] [hash <MB>] [seed <n>]\n");
+        return;
+    }
+    // A depth on its own replaces the default node limit
+    if (depthSet && !nodesSet)
+        params.nodes = 0;
+    Datagen::run(params);
+}
+
+// convert <input> <output>: packed files (.bin) become text and anything else is packed
+void parseConvert(const std::string& command) {
+    std::istringstream stream(command.substr(7));
+    std::string inPath, outPath;
+    stream >> inPath >> outPath;
+    if (outPath.empty()) {
+        printf("Usage: convert <input> <output>\n");
+        return;
+    }
+    Time::start();
+    bool packed = inPath.size() > 4 && inPath.compare(inPath.size() - 4, 4, ".bin") == 0;
+    size_t count = packed ? Packed::packedToText(inPath, outPath)
+                          : Packed::textToPacked(inPath, outPath);
+    printf("Converted %zu positions in %lld ms\n", count, Time::end());
+}
+
 void parseGo(const std::string& command) {
     // Reset time control related variables
     quit = false;
     stop = false;
     isTimeControlled = false;
+    pondering = false;
+    isInfinite = false;
     timeLeft = -1;
     increment = 0;
     movesToGo = 40;
     moveTime = -1;
+    nodeLimit = 0;
     // Shift pointer to the beginning of args
     int currentInd = 3;
     int depth = -1;
-    if (command.compare(currentInd, 5, "perft") == 0) {
+    if (command.compare(currentInd, 10, "perft nnue") == 0) {
+        currentInd += 10 + 1;
+        Perft::nnueTest(mainBoard, atoi(command.substr(currentInd).c_str()));
+        return;
+    } else if (command.compare(currentInd, 5, "perft") == 0) {
         currentInd += 5 + 1;
         Perft::test(mainBoard, atoi(command.substr(currentInd).c_str()));
         return;
     } else if (command.compare(currentInd, 5, "depth") == 0) {
         currentInd += 5 + 1;
         depth = atoi(command.substr(currentInd).c_str());
+        listening = true;
         Search::position(mainBoard, depth);
+        listening = false;
         return;
     }
 
@@ -133,6 +502,9 @@ void parseGo(const std::string& command) {
     }
     parseParam(command.substr(currentInd), "movetime", moveTime);
     parseParam(command.substr(currentInd), "movestogo", movesToGo);
+    int nodes = 0;
+    parseParam(command.substr(currentInd), "nodes", nodes);
+    nodeLimit = nodes;
 
     if (moveTime != -1) {
         timeLeft = moveTime;
@@ -150,10 +522,18 @@ void parseGo(const std::string& command) {
         else
             stopTime = startTime + increment + timeLeft;
     }
+    pondering = command.find("ponder") != std::string::npos;
+    isInfinite = command.find("infinite") != std::string::npos;
+    if (pondering) {
+        ponderBudget = stopTime - startTime;
+        isTimeControlled = false;
+    }
 
     if (depth == -1)
         depth = Search::MAX_PLY;
+    listening = true;
     Search::position(mainBoard, depth);
+    listening = false;
 }
 
 void parseParam(const std::string& cmdArgs, const std::string& cmdName, int& output) {
@@ -168,9 +548,51 @@ void parseParam(const std::string& cmdArgs, const std::string& cmdName, int& out
     }
 }
 
+// Commands understood while searching; the others wait until the search is over
+void parseSearchCommand(const std::string& command) {
+    if (command == "stop" || command == "quit") {
+        stop = true;
+        quit = command == "quit";
+        pondering = isInfinite = false;
+    } else if (command == "ponderhit") {
+        // The search goes on with its tables and history, now against the clock
+        if (pondering && timeLeft != -1) {
+            isTimeControlled = true;
+            stopTime = Time::now() + ponderBudget;
+        }
+        pondering = false;
+    } else if (command == "isready") {
+        printf("readyok\n");
+        fflush(stdout);
+    } else
+        deferredCommands.push_back(command);
+}
+
+// A search that has finished while pondering or in infinite mode may only send its best move
+// after "ponderhit" or "stop"
+void waitForStop() {
+    if (!listening)
+        return;
+    fflush(stdout);
+    std::string command;
+    while ((pondering || isInfinite) && !stop) {
+        if (!nextLine(command, true)) {
+            stop = true;
+            break;
+        }
+        parseSearchCommand(command);
+    }
+}
+
+// Node limits are only checked here, so searches may overshoot them by up to one check interval
 void checkUp() {
+    std::string command;
+    while (listening && nextLine(command, false))
+        parseSearchCommand(command);
     if (isTimeControlled && Time::now() >= stopTime)
         stop = true;
+    if (nodeLimit && Search::nodes >= nodeLimit)
+        stop = true;
 }
 
 void printEngineInfo() {
@@ -201,98 +623,55 @@ void printHelpInfo() {
            "move given the time for a single move\n");
     printf("go (wtime/btime) <time>(winc/binc) <time>  |    Returns the best "
            "move given the total amount of time for a move with increment\n");
+    printf("     go nodes <nodes>                      |    Returns the best "
+           "move after searching about the given number of nodes\n");
     printf("                 quit                      |    Exit the UCI mode\n");
     printf("\n------------------------------------ EXTENSIONS "
            "----------------------------------------\n");
     printf("              display                      |    Display board\n");
+    printf("                 eval                      |    Print the evaluation of the "
+           "board term by term\n");
     printf("     go perft <depth>                      |    Calculate the total "
            "number of moves from a position for a given depth\n");
+    printf("go perft nnue <depth>                      |    Check the incrementally updated NNUE "
+           "accumulators against full refreshes at every leaf of a perft tree\n");
+    printf("setoption name EvalHash value <MB>        |    Set the size of the "
+           "evaluation cache\n");
+    printf("setoption name EvalFile value <path>      |    Load an NNUE network file\n");
+    printf("setoption name UseNNUE value <true/false> |    Evaluate with the loaded NNUE "
+           "network\n");
+    printf("setoption name MultiPV value <n>          |    Search and report the best <n> "
+           "lines\n");
+    printf("        bench <depth>                      |    Search the bench "
+           "positions to a fixed depth (default 8) and print the node count and speed\n");
+    printf("   bench eval <passes>                     |    Evaluate the bench "
+           "positions and their children (default 50 passes) and print evals/sec\n");
+    printf("     tune <file> [epochs <n>] [threads <n>] [lr <x>] [output <path>]\n"
+           "                                           |    Tune the evaluation on positions "
+           "labelled with results and write a new eval_constants.cpp\n");
+    printf("   bench nnue <passes>                     |    Time NNUE inference with full "
+           "refreshes and with incremental updates\n");
+    printf("        match [games <n>] [concurrency <n>] [openings <file>] [tc <s>[+<inc>]]\n"
+           "              [nodes <n>] [sprt <elo0> <elo1> [<alpha> <beta>]]\n"
+           "              [engine1|engine2 [cmd <command>] [option <name>=<value>] ...]\n"
+           "                                           |    Play two engines (this one by "
+           "default) against each other and report Elo, LOS and the SPRT state\n");
+    printf("      analyse <input> <output> depth|nodes|movetime <n> [threads <n>] [hash <MB>]\n"
+           "              [format csv|json]\n"
+           "                                           |    Search every position of an "
+           "EPD or packed file on a pool of workers and write the results in input order\n");
+    printf("    testsuite <file> [movetime <ms>]       |    Search every 'bm'/'am' position "
+           "of an EPD file and report the solved count and the time to solution\n");
+    printf("         spsa [iterations <n>] [pairs <n>] [concurrency <n>] [openings <file>]\n"
+           "              [tc <s>[+<inc>]] [nodes <n>] [lr <x>] [cmd <command>] [params <a>,<b>]\n"
+           "                                           |    Tune the search parameters "
+           "(all by default) with SPSA over short self-play games\n");
+    printf("      datagen <output> [positions <n>] [threads <n>] [depth <n>] [nodes <n>]\n"
+           "              [random <n>] [hash <MB>] [seed <n>]\n"
+           "                                           |    Play self-play games on several "
+           "threads and append their quiet positions, scores and results as packed records\n");
+    printf("      convert <input> <output>             |    Convert text positions to 32 byte "
+           "packed records, or packed records (.bin) back to text\n");
 }
 
-/*
-int input_waiting() {
-#ifdef _WIN32
-  fd_set readfds;
-  struct timeval tv;
-  FD_ZERO(&readfds);
-  FD_SET(fileno(stdin), &readfds);
-  tv.tv_sec = 0;
-  tv.tv_usec = 0;
-  select(16, &readfds, 0, 0, &tv);
-
-  return (FD_ISSET(fileno(stdin), &readfds));
-#else
-  static int init = 0, pipe;
-  static HANDLE inh;
-  DWORD dw;
-
-  if (!init) {
-    init = 1;
-    inh = GetStdHandle(STD_INPUT_HANDLE);
-    pipe = !GetConsoleMode(inh, &dw);
-    if (!pipe) {
-      SetConsoleMode(inh, dw & ~(ENABLE_MOUSE_INPUT | ENABLE_WINDOW_INPUT));
-      FlushConsoleInputBuffer(inh);
-    }
-  }
-
-  if (pipe) {
-    if (!PeekNamedPipe(inh, NULL, 0, NULL, &dw, NULL))
-      return 1;
-    return dw;
-  }
-
-  else {
-    GetNumberOfConsoleInputEvents(inh, &dw);
-    return dw <= 1 ? 0 : dw;
-  }
-
-#endif
-}
-
-// read GUI/user input
-void read_input() {
-  // bytes to read holder
-  int bytes;
-
-  // GUI/user input
-  std::string input = "";
-  char *endc;
-
-  // "listen" to STDIN
-  if (input_waiting()) {
-    // tell engine to stop calculating
-    stop = true;
-
-    // loop to read bytes from STDIN
-    do {
-      // read bytes from STDIN
-      bytes = read(_fileno(stdin), input, 256);
-    }
-
-    // until bytes available
-    while (bytes < 0);
-
-    // searches for the first occurrence of '\n'
-    endc = strchr(input, '\n');
-
-    // if found new line set value at pointer to 0
-    if (endc)
-      *endc = 0;
-
-    // if input is available
-    if (strlen(input) > 0) {
-      // match UCI "quit" command
-      if (!strncmp(input, "quit", 4))
-        // tell engine to terminate exacution
-        quit = 1;
-
-      // // match UCI "stop" command
-      else if (!strncmp(input, "stop", 4))
-        // tell engine to terminate exacution
-        quit = 1;
-    }
-  }
-}*/
-
 } // namespace UCI
@@ -14,6 +14,8 @@ std::array<uint64_t, 8> enpassLocks;
 std::array<uint64_t, 16> castlingLocks;
 uint64_t sideLock;
 
+std::array<std::array<uint64_t, 10>, 12> materialKeys;
+
 void init() {
   // Init piece keys and locks
   for (int piece = (int)Piece::P; piece <= (int)Piece::k; piece++) {
@@ -37,6 +39,21 @@ void init() {
 
   sideKey = random64();
   sideLock = random64();
+
+  // Init material keys for up to 10 pieces of a kind (2 knights and 8 promotions)
+  for (auto &piece : materialKeys)
+    for (auto &key : piece)
+      key = random64();
+}
+
+uint64_t genMaterialKey(const Board &board) {
+  uint64_t output = 0ULL;
+  for (int piece = (int)Piece::P; piece <= (int)Piece::k; piece++) {
+    int count = Bitboard::countBits(board.pos.pieces[piece]);
+    for (int i = 0; i < count; i++)
+      output ^= materialKeys[piece][i];
+  }
+  return output;
 }
 
 uint64_t genKey(const Board &board) {